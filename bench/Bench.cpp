@@ -0,0 +1,124 @@
+//
+// Created by Andrew Simmons on 10/15/26.
+//
+
+#include "Bench.h"
+#if defined(ESP_PLATFORM)
+#include <Esp.h>
+#include <esp_timer.h>
+#else
+#include <chrono>
+#endif
+
+double Bench::samples[BENCH_MAX_SAMPLES];
+
+unsigned long long Bench::counter()
+{
+#if defined(ESP_PLATFORM)
+    return ESP.getCycleCount();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+// The cycle counter is 32 bits, so the difference has to be too or a wrap reads as ~2^64
+unsigned long long Bench::counterSince(unsigned long long start)
+{
+#if defined(ESP_PLATFORM)
+    return (uint32_t)((uint32_t)counter() - (uint32_t)start);
+#else
+    return counter() - start;
+#endif
+}
+
+unsigned long long Bench::counterNs()
+{
+#if defined(ESP_PLATFORM)
+    return (unsigned long long)esp_timer_get_time() * 1000ULL;
+#else
+    return (unsigned long long)counterToNs(counter());
+#endif
+}
+
+double Bench::counterToNs(unsigned long long ticks)
+{
+#if defined(ESP_PLATFORM)
+    return ticks * 1000.0 / getCpuFrequencyMhz();
+#else
+    return (double)ticks;
+#endif
+}
+
+static int compareSamples(const void *a, const void *b)
+{
+    double da = *(const double *)a;
+    double db = *(const double *)b;
+    return da < db ? -1 : (da > db ? 1 : 0);
+}
+
+BenchResult Bench::run(const char *name, void (*fn)(void *, unsigned long), void *ctx, unsigned long calls)
+{
+    // Warm up caches/branch predictors, and on the host let the clock settle
+    for(unsigned long i = 0; i < BENCH_BATCH * 4; i++)
+        fn(ctx, i);
+
+    unsigned long batches = calls / BENCH_BATCH;
+    if(batches == 0)
+        batches = 1;
+    // Keep at most BENCH_MAX_SAMPLES batches, evenly spread
+    unsigned long stride = (batches + BENCH_MAX_SAMPLES - 1) / BENCH_MAX_SAMPLES;
+    unsigned int sampleCount = 0;
+    double totalNs = 0;
+    unsigned long i = 0;
+
+    for(unsigned long batch = 0; batch < batches; batch++)
+    {
+        unsigned long long start = counter();
+        for(byte b = 0; b < BENCH_BATCH; b++)
+            fn(ctx, i++);
+        double ns = counterToNs(counterSince(start)) / BENCH_BATCH;
+        totalNs += ns;
+        if(batch % stride == 0 && sampleCount < BENCH_MAX_SAMPLES)
+            samples[sampleCount++] = ns;
+    }
+
+    qsort(samples, sampleCount, sizeof(double), compareSamples);
+
+    BenchResult result;
+    result.name = name;
+    result.calls = batches * BENCH_BATCH;
+    result.meanNs = totalNs / batches;
+    result.p99BatchNs = samples[(sampleCount * 99) / 100 < sampleCount ? (sampleCount * 99) / 100 : sampleCount - 1];
+    result.minBatchNs = samples[0];
+    result.callsPerSec = result.meanNs > 0 ? 1e9 / result.meanNs : 0;
+    report(result);
+    return result;
+}
+
+void Bench::report(const BenchResult &result)
+{
+    Serial.printf("{\"bench\":\"%s\",\"calls\":%lu,\"mean_ns\":%.2f,\"p99_batch_ns\":%.2f,\"min_batch_ns\":%.2f,\"calls_per_sec\":%.0f}\n",
+                  result.name, result.calls, result.meanNs, result.p99BatchNs, result.minBatchNs, result.callsPerSec);
+}
+
+void Bench::reportValue(const char *name, const char *unit, double value)
+{
+    Serial.printf("{\"bench\":\"%s\",\"%s\":%.3f}\n", name, unit, value);
+}
+
+void Bench::advanceMicros(unsigned long long us)
+{
+#if !defined(ESP_PLATFORM)
+    VirtualClock::advance(us);
+#endif
+}
+
+void Bench::finish()
+{
+    Serial.printf("{\"done\":true}\n");
+    Serial.flush();
+#if !defined(ESP_PLATFORM)
+    exit(0);
+#endif
+}
@@ -0,0 +1,56 @@
+//
+// Created by Andrew Simmons on 10/15/26.
+//
+
+#ifndef FIRMWORK_BENCH_H
+#define FIRMWORK_BENCH_H
+#include <Arduino.h>
+
+// Calls are timed in batches so the counter read doesn't swamp tiny functions. mean is per
+// call over the whole run, min/p99 are taken over the batches' per call averages, so one slow
+// call only shows up diluted by its batch. Host uses steady_clock, the ESP32 uses the CPU
+// cycle counter.
+#define BENCH_BATCH 32
+#define BENCH_MAX_SAMPLES 1024
+#define BENCH_DEFAULT_CALLS 32768
+
+typedef struct BenchResult
+{
+    const char *name;
+    unsigned long calls;
+    double meanNs;
+    double p99BatchNs;
+    double minBatchNs;
+    double callsPerSec;
+} BenchResult;
+
+class Bench
+{
+    public:
+        // fn gets ctx and the call index, so it can walk data or move time without globals
+        static BenchResult run(const char *name, void (*fn)(void *ctx, unsigned long i), void *ctx,
+                               unsigned long calls = BENCH_DEFAULT_CALLS);
+        // One JSON object per line, easy to diff or feed to a script in CI
+        static void report(const BenchResult &result);
+        // For results that aren't call timings, e.g. simulated job time
+        static void reportValue(const char *name, const char *unit, double value);
+        // Moves time on the host's virtual clock, nothing on the device (real time moves by itself)
+        static void advanceMicros(unsigned long long us);
+        static void finish();
+        // Wall clock for timing things that aren't one call. steady_clock on the host, esp_timer
+        // on the ESP32 since the cycle counter wraps every ~18s at 240MHz.
+        static unsigned long long counterNs();
+    private:
+        static unsigned long long counter();
+        static unsigned long long counterSince(unsigned long long start);
+        static double counterToNs(unsigned long long ticks);
+        static double samples[BENCH_MAX_SAMPLES];
+};
+
+void runTimerBenchmarks();
+void runStepperBenchmarks();
+void runMathBenchmarks();
+void runGcodeBenchmarks();
+
+
+#endif //FIRMWORK_BENCH_H
@@ -0,0 +1,45 @@
+//
+// Created by Andrew Simmons on 10/15/26.
+//
+
+#include "Bench.h"
+#include "GcodeParser.h"
+
+// What a plotter job looks like: mostly short G1s with 3 decimals, some comments and pen M-codes
+static const char *const gcodeLines[] = {
+        "G90 ; absolute\n",
+        "G0 X12.500 Y40.000\n",
+        "M3 S90 (pen down)\n",
+        "G1 X12.734 Y40.512 F3000\n",
+        "G1 X13.201 Y41.020\n",
+        "G1 X13.902 Y41.498\n",
+        "G1 X14.830 Y41.927\n",
+        "G1 X15.976 Y42.289\n",
+        "N120 G1 X17.322 Y42.570*71\n",
+        "G1 X18.850 Y42.758\n",
+        "M5 (pen up)\n",
+        "G91\n",
+        "G1 X-2.5 Y0.125\n",
+        "G90\n",
+};
+#define GCODE_LINE_COUNT (sizeof(gcodeLines) / sizeof(gcodeLines[0]))
+
+// One line per call, so calls_per_sec is lines/s
+static void parseLine(void *ctx, unsigned long i)
+{
+    GcodeParser *parser = (GcodeParser *)ctx;
+    for(const char *c = gcodeLines[i % GCODE_LINE_COUNT]; *c; c++)
+        parser->feed(*c);
+    GcodeCommand command;
+    while(parser->pop(command));
+}
+
+void runGcodeBenchmarks()
+{
+    FloatMapper xSteps({0, 1}, {0, 80});
+    FloatMapper ySteps({0, 1}, {0, 80});
+    GcodeParser parser;
+    parser.setAxis(0, 'X', &xSteps);
+    parser.setAxis(1, 'Y', &ySteps);
+    Bench::run("gcode_parse_line", parseLine, &parser);
+}
@@ -0,0 +1,198 @@
+//
+// Created by Andrew Simmons on 10/15/26.
+//
+
+#include "Bench.h"
+#include "MathHelper.h"
+#include "Mapper.h"
+
+static volatile float floatSink;
+static volatile long longSink;
+static volatile double doubleSink;
+static MathHelper helper;
+
+static void benchMap(void *, unsigned long i)
+{
+    doubleSink = MathHelper::map(i & 4095, 0, 4095, -1.0, 1.0);
+}
+
+static void benchFloatMap(void *, unsigned long i)
+{
+    floatSink = helper.FloatMap((float)(i & 4095), 0, 4095, -1.0f, 1.0f);
+}
+
+static void benchFRangeMap(void *, unsigned long i)
+{
+    static const FloatRange in = {0, 4095};
+    static const FloatRange out = {-1.0f, 1.0f};
+    floatSink = helper.FRangeMap((float)(i & 4095), in, out);
+}
+
+static void benchLongMap(void *, unsigned long i)
+{
+    longSink = helper.LongMap(i & 4095, 0, 4095, -20000, 20000);
+}
+
+static void benchLRangeMap(void *, unsigned long i)
+{
+    static const LRange in = {0, 4095};
+    static const LRange out = {-20000, 20000};
+    longSink = helper.LRangeMap(i & 4095, in, out);
+}
+
+static void benchULongMap(void *, unsigned long i)
+{
+    longSink = helper.ULongMap(i & 4095, 0, 4095, 0, 40000);
+}
+
+static void benchLLongMap(void *, unsigned long i)
+{
+    longSink = (long)helper.LLongMap(i & 4095, 0, 4095, -20000, 20000);
+}
+
+static void benchIntMap(void *, unsigned long i)
+{
+    longSink = MathHelper::IntMap(i & 4095, 0, 4095, -20000, 20000);
+}
+
+static void benchIntMapSaturated(void *, unsigned long i)
+{
+    longSink = MathHelper::IntMap(i & 8191, 0, 4095, -20000, 20000, MAP_ROUND_NEAREST, true);
+}
+
+// Step position to Q16.16 mm over a long axis, the range LongMap overflows on
+static void benchIntMapStepsToQ16(void *, unsigned long i)
+{
+    longSink = MathHelper::IntMap((long)(i * 997) & 0xFFFFF, 0, 1000000, 0, 500 * Q16_16_ONE, MAP_ROUND_FLOOR);
+}
+
+static void benchFloatMapper(void *ctx, unsigned long i)
+{
+    floatSink = ((FloatMapper *)ctx)->map((float)(i & 4095));
+}
+
+static void benchFloatMapperInverse(void *ctx, unsigned long i)
+{
+    floatSink = ((FloatMapper *)ctx)->inverse((float)(i & 4095) / 2048.0f - 1.0f);
+}
+
+static void benchLongMapper(void *ctx, unsigned long i)
+{
+    longSink = ((LongMapper *)ctx)->map(i & 4095);
+}
+
+static void benchIntMapper(void *ctx, unsigned long i)
+{
+    longSink = ((IntMapper *)ctx)->map(i & 8191);
+}
+
+static void benchIntMapperStepsToQ16(void *ctx, unsigned long i)
+{
+    longSink = ((IntMapper *)ctx)->map((long)(i * 997) & 0xFFFFF);
+}
+
+#define BENCH_BLOCK 256
+
+typedef struct BlockBench
+{
+    float floats[BENCH_BLOCK] __attribute__((aligned(16)));
+    float mapped[BENCH_BLOCK] __attribute__((aligned(16)));
+    int16_t samples[BENCH_BLOCK] __attribute__((aligned(16)));
+    int16_t mappedSamples[BENCH_BLOCK] __attribute__((aligned(16)));
+    int32_t positions[BENCH_BLOCK] __attribute__((aligned(16)));
+    int32_t mappedPositions[BENCH_BLOCK] __attribute__((aligned(16)));
+    FloatMapper *floatMapper;
+    LongMapper *longMapper;
+} BlockBench;
+
+// One call is a whole 256 sample block
+static void benchBlockFloatMapLoop(void *ctx, unsigned long)
+{
+    BlockBench *block = (BlockBench *)ctx;
+    for(unsigned int s = 0; s < BENCH_BLOCK; s++)
+        block->mapped[s] = helper.FloatMap(block->floats[s], 0, 4095, -1.0f, 1.0f);
+}
+
+static void benchBlockFloatMapArray(void *ctx, unsigned long)
+{
+    BlockBench *block = (BlockBench *)ctx;
+    block->floatMapper->mapArray(block->floats, block->mapped, BENCH_BLOCK);
+}
+
+static void benchBlockInt16ToFloatArray(void *ctx, unsigned long)
+{
+    BlockBench *block = (BlockBench *)ctx;
+    block->floatMapper->mapArray(block->samples, block->mapped, BENCH_BLOCK);
+}
+
+static void benchBlockLongMapLoop(void *ctx, unsigned long)
+{
+    BlockBench *block = (BlockBench *)ctx;
+    for(unsigned int s = 0; s < BENCH_BLOCK; s++)
+        block->mappedSamples[s] = helper.LongMap(block->samples[s], 0, 4095, -20000, 20000);
+}
+
+static void benchBlockInt16Array(void *ctx, unsigned long)
+{
+    BlockBench *block = (BlockBench *)ctx;
+    block->longMapper->mapArray(block->samples, block->mappedSamples, BENCH_BLOCK);
+}
+
+static void benchBlockInt32Array(void *ctx, unsigned long)
+{
+    BlockBench *block = (BlockBench *)ctx;
+    block->longMapper->mapArray(block->positions, block->mappedPositions, BENCH_BLOCK);
+}
+
+static void runBlockBenchmarks()
+{
+    static BlockBench block;
+    for(unsigned int s = 0; s < BENCH_BLOCK; s++)
+    {
+        block.samples[s] = (s * 37) & 4095;
+        block.floats[s] = block.samples[s];
+        block.positions[s] = block.samples[s];
+    }
+    FloatMapper floatMapper({0, 4095}, {-1.0f, 1.0f});
+    LongMapper longMapper({0, 4095}, {-20000, 20000});
+    block.floatMapper = &floatMapper;
+    block.longMapper = &longMapper;
+
+    unsigned long calls = BENCH_DEFAULT_CALLS / 16;
+    Bench::run("math_block256_float_map_loop", benchBlockFloatMapLoop, &block, calls);
+    Bench::run("math_block256_float_map_array", benchBlockFloatMapArray, &block, calls);
+    Bench::run("math_block256_int16_to_float_array", benchBlockInt16ToFloatArray, &block, calls);
+    Bench::run("math_block256_long_map_loop", benchBlockLongMapLoop, &block, calls);
+    Bench::run("math_block256_int16_array", benchBlockInt16Array, &block, calls);
+    Bench::run("math_block256_int32_array", benchBlockInt32Array, &block, calls);
+}
+
+void runMathBenchmarks()
+{
+    Bench::run("math_map_double", benchMap, nullptr);
+    Bench::run("math_float_map", benchFloatMap, nullptr);
+    Bench::run("math_frange_map", benchFRangeMap, nullptr);
+    Bench::run("math_long_map", benchLongMap, nullptr);
+    Bench::run("math_lrange_map", benchLRangeMap, nullptr);
+    Bench::run("math_ulong_map", benchULongMap, nullptr);
+    Bench::run("math_llong_map", benchLLongMap, nullptr);
+    Bench::run("math_int_map", benchIntMap, nullptr);
+    Bench::run("math_int_map_saturated", benchIntMapSaturated, nullptr);
+    Bench::run("math_int_map_steps_to_q16", benchIntMapStepsToQ16, nullptr);
+
+    FloatMapper floatMapper({0, 4095}, {-1.0f, 1.0f});
+    Bench::run("math_float_mapper", benchFloatMapper, &floatMapper);
+    Bench::run("math_float_mapper_inverse", benchFloatMapperInverse, &floatMapper);
+    FloatMapper clampedMapper({0, 4095}, {-1.0f, 1.0f}, true);
+    Bench::run("math_float_mapper_clamped", benchFloatMapper, &clampedMapper);
+    LongMapper longMapper({0, 4095}, {-20000, 20000});
+    Bench::run("math_long_mapper", benchLongMapper, &longMapper);
+    LongMapper clampedLongMapper({0, 4095}, {-20000, 20000}, true);
+    Bench::run("math_long_mapper_clamped", benchLongMapper, &clampedLongMapper);
+    IntMapper intMapper({0, 4095}, {-20000, 20000}, MAP_ROUND_NEAREST, true);
+    Bench::run("math_int_mapper_saturated", benchIntMapper, &intMapper);
+    IntMapper stepsToQ16({0, 1000000}, {0, 500 * Q16_16_ONE}, MAP_ROUND_FLOOR);
+    Bench::run("math_int_mapper_steps_to_q16", benchIntMapperStepsToQ16, &stepsToQ16);
+
+    runBlockBenchmarks();
+}
@@ -0,0 +1,454 @@
+//
+// Created by Andrew Simmons on 10/15/26.
+//
+
+#include "Bench.h"
+#include "StepperManager.h"
+#include "StepperGroup.h"
+#include "MotionPlanner.h"
+#if !defined(ESP_PLATFORM)
+#include <StepperSimulator.h>
+#endif
+
+static boolean limitNeverHit()
+{
+    return false;
+}
+
+static void stepperRun(void *ctx, unsigned long)
+{
+    ((StepperManager *)ctx)->run();
+}
+
+// On the host this makes every call a step, on the device it's whatever real time gives us
+static void stepperRunStepping(void *ctx, unsigned long)
+{
+    Bench::advanceMicros(100);
+    ((StepperManager *)ctx)->run();
+}
+
+typedef struct AxisPair
+{
+    StepperManager *x;
+    StepperManager *y;
+    StepperGroup *group;
+} AxisPair;
+
+static void pairRunSeparate(void *ctx, unsigned long)
+{
+    AxisPair *pair = (AxisPair *)ctx;
+    Bench::advanceMicros(100);
+    pair->x->run();
+    pair->y->run();
+}
+
+static void pairRunGroup(void *ctx, unsigned long)
+{
+    Bench::advanceMicros(100);
+    ((AxisPair *)ctx)->group->run();
+}
+
+static void stepNowhere()
+{
+}
+
+// Cruising at 10k steps/s with FUNCTION wiring that does nothing, so all that's left is each
+// path's per step timing maths. On the host the pin writes would swamp it.
+static void runStepPathBenchmarks()
+{
+    AccelStepper stepper(stepNowhere, stepNowhere);
+    StepperManager manager(&stepper);
+    manager.setMaxSpeed(10000);
+    manager.setAcceleration(20000);
+    manager.moveToAbsolute(100000000);
+    for(unsigned long i = 0; i < 20000; i++)
+        stepperRunStepping(&manager, i);
+    Bench::run("stepper_step_path_accel", stepperRunStepping, &manager);
+    manager.stop();
+    manager.setCurrentPosition(0);
+
+    StepProfile profile;
+    profile.setMaxSpeed(10000);
+    profile.setAcceleration(20000);
+    manager.setProfile(&profile);
+    manager.moveProfiled(100000000);
+    for(unsigned long i = 0; i < 20000; i++)
+        stepperRunStepping(&manager, i);
+    Bench::run("stepper_step_path_profile", stepperRunStepping, &manager);
+    manager.stop();
+}
+
+static void runGroupBenchmarks()
+{
+    AccelStepper stepperX(AccelStepper::DRIVER, 2, 3);
+    AccelStepper stepperY(AccelStepper::DRIVER, 4, 5);
+    StepperManager x(&stepperX);
+    StepperManager y(&stepperY);
+    StepperGroup group;
+    group.addStepper(&x);
+    group.addStepper(&y);
+    AxisPair pair = {&x, &y, &group};
+
+    x.setMaxSpeed(10000);
+    x.setAcceleration(20000);
+    y.setMaxSpeed(10000);
+    y.setAcceleration(20000);
+    x.moveToAbsolute(100000000);
+    y.moveToAbsolute(50000000);
+    Bench::run("stepper_xy_separate_run", pairRunSeparate, &pair);
+    x.setCurrentPosition(0);
+    y.setCurrentPosition(0);
+
+    group.setMaxSpeed(10000);
+    group.setAcceleration(20000);
+    long target[] = {100000000, 50000000};
+    group.moveToAbsolute(target);
+    Bench::run("stepper_xy_group_run", pairRunGroup, &pair);
+    group.hardStop();
+}
+
+#if !defined(ESP_PLATFORM)
+// Job time for a path on the virtual clock: a circle, a square and a zigzag, the kind of short
+// segments G-code paths are made of. Stop-at-every-corner group moves vs the lookahead planner.
+#define PATH_POINTS 64
+#define PATH_SPEED 8000
+#define PATH_ACCELERATION 40000
+#define PATH_TICK_MICROS 10
+
+static int buildPath(long path[][2])
+{
+    int count = 0;
+    for(int i = 1; i <= 36; i++)
+    {
+        float angle = i * 2.0f * (float)M_PI / 36;
+        path[count][0] = lroundf(8000 * cosf(angle)) - 8000;
+        path[count][1] = lroundf(8000 * sinf(angle));
+        count++;
+    }
+    long square[][2] = {{4000, 0}, {4000, 4000}, {0, 4000}, {0, 0}};
+    for(int i = 0; i < 4; i++, count++)
+    {
+        path[count][0] = square[i][0];
+        path[count][1] = square[i][1];
+    }
+    for(int i = 1; i <= 20; i++, count++)
+    {
+        path[count][0] = i * 500;
+        path[count][1] = (i % 2) * 300;
+    }
+    return count;
+}
+
+static double runPathJob(bool usePlanner)
+{
+    AccelStepper stepperX(AccelStepper::DRIVER, 2, 3);
+    AccelStepper stepperY(AccelStepper::DRIVER, 4, 5);
+    StepperManager x(&stepperX);
+    StepperManager y(&stepperY);
+    StepperGroup group;
+    group.addStepper(&x);
+    group.addStepper(&y);
+    group.setMaxSpeed(PATH_SPEED);
+    group.setAcceleration(PATH_ACCELERATION);
+    MotionPlanner planner(&group);
+    planner.setAcceleration(PATH_ACCELERATION);
+    planner.setJunctionDeviation(20);
+
+    long path[PATH_POINTS][2];
+    int points = buildPath(path);
+    unsigned long long start = VirtualClock::now();
+    int next = 0;
+    while(true)
+    {
+        if(usePlanner)
+        {
+            while(next < points && planner.addLine(path[next], PATH_SPEED))
+                next++;
+            if(!planner.run() && next == points)
+                break;
+        }
+        else if(!group.run())
+        {
+            if(next == points)
+                break;
+            group.moveToAbsolute(path[next++]);
+        }
+        Bench::advanceMicros(PATH_TICK_MICROS);
+    }
+    return (VirtualClock::now() - start) / 1000000.0;
+}
+
+// loop() that blocks for BLOCKING_LOOP_MICROS at a time (WiFi, a display refresh), polled
+// run() vs the timer backend, which only needs run() to top its queue up
+#define BLOCKING_LOOP_MICROS 5000
+#define BLOCKING_MOVE_STEPS 20000
+
+static double runBlockingJob(bool useBackend, unsigned long *underruns, unsigned long *maxError)
+{
+    AccelStepper stepper(AccelStepper::DRIVER, 6, 7);
+    StepperManager manager(&stepper);
+    StepProfile profile;
+    profile.setMaxSpeed(10000);
+    profile.setAcceleration(20000);
+    manager.setProfile(&profile);
+    StepTimerBackend backend(6, 7);
+    backend.setJitter(3);
+    backend.begin();
+    manager.setBackend(&backend);
+
+    unsigned long long start = VirtualClock::now();
+    unsigned long long lastRun = start;
+    if(useBackend)
+        manager.moveQueued(BLOCKING_MOVE_STEPS);
+    else
+        manager.moveProfiled(BLOCKING_MOVE_STEPS);
+    while(manager.getMode() != STEPPER_NONE)
+    {
+        Bench::advanceMicros(PATH_TICK_MICROS);
+        backend.service();
+        if(VirtualClock::now() - lastRun >= BLOCKING_LOOP_MICROS)
+        {
+            manager.run();
+            lastRun = VirtualClock::now();
+        }
+    }
+    backend.end();
+    *underruns = backend.getUnderruns();
+    *maxError = backend.getMaxTimingError();
+    return (VirtualClock::now() - start) / 1000000.0;
+}
+
+static void runBlockingBenchmarks()
+{
+    unsigned long underruns, maxError;
+    Bench::reportValue("stepper_blocking_loop_polled", "seconds", runBlockingJob(false, &underruns, &maxError));
+    Bench::reportValue("stepper_blocking_loop_backend", "seconds", runBlockingJob(true, &underruns, &maxError));
+    Bench::reportValue("stepper_blocking_loop_backend_underruns", "ticks", underruns);
+    Bench::reportValue("stepper_blocking_loop_backend_max_error", "micros", maxError);
+}
+
+// Three axes homing onto switches at different distances, one after another (how the hand
+// rolled blocking versions do it) vs all at once off run()
+#define HOMING_AXES 3
+
+typedef struct HomingAxis
+{
+    AccelStepper *stepper;
+    StepperManager *manager;
+    LimitSwitch *limit;
+    long switchAt;
+} HomingAxis;
+
+// Stand in for the machine: each switch closes once its axis is at or past it
+static void updateHomingSwitches(HomingAxis *axes)
+{
+    for(byte i = 0; i < HOMING_AXES; i++)
+        VirtualPins::set(axes[i].limit->getPin(), axes[i].stepper->currentPosition() <= axes[i].switchAt ? LOW : HIGH);
+}
+
+static double runHomingJob(bool concurrent)
+{
+    AccelStepper steppers[HOMING_AXES] = {AccelStepper(AccelStepper::DRIVER, 10, 11),
+                                          AccelStepper(AccelStepper::DRIVER, 12, 13),
+                                          AccelStepper(AccelStepper::DRIVER, 14, 15)};
+    StepperManager x(&steppers[0]), y(&steppers[1]), z(&steppers[2]);
+    LimitSwitch limitX(30), limitY(31), limitZ(32);
+    HomingAxis axes[HOMING_AXES] = {{&steppers[0], &x, &limitX, -4000},
+                                    {&steppers[1], &y, &limitY, -2500},
+                                    {&steppers[2], &z, &limitZ, -1200}};
+    HomingConfig config = {false, 4000, 400, 200, 50, 0, 20000};
+    for(byte i = 0; i < HOMING_AXES; i++)
+    {
+        axes[i].limit->setDebounceMicros(500);
+        axes[i].limit->beginInterrupt();
+        axes[i].manager->setLimitSwitches(axes[i].limit, nullptr);
+    }
+    updateHomingSwitches(axes);
+
+    unsigned long long start = VirtualClock::now();
+    byte first = 0;
+    while(first < HOMING_AXES)
+    {
+        byte last = concurrent ? HOMING_AXES - 1 : first;
+        for(byte i = first; i <= last; i++)
+            axes[i].manager->home(config);
+        bool homing = true;
+        while(homing)
+        {
+            homing = false;
+            for(byte i = first; i <= last; i++)
+            {
+                axes[i].manager->run();
+                homing |= axes[i].manager->isHoming();
+            }
+            Bench::advanceMicros(PATH_TICK_MICROS);
+            updateHomingSwitches(axes);
+        }
+        first = last + 1;
+    }
+    return (VirtualClock::now() - start) / 1000000.0;
+}
+
+static void runHomingBenchmarks()
+{
+    Bench::reportValue("stepper_homing_sequential", "seconds", runHomingJob(false));
+    Bench::reportValue("stepper_homing_concurrent", "seconds", runHomingJob(true));
+}
+
+// 80 minutes of back and forth moves against a simulated axis with hard stops and switches, clock
+// jumping from step to step. Long enough that micros() wraps (every 71.6 minutes) at least once
+// mid job, and every other round trip is off a StepProfile so both step clocks cross it. Reports
+// how much faster than real time it runs, and checks the mechanical position agrees with the
+// stepper's (nothing lost on the way).
+#define SIMULATED_JOB_MICROS 4800000000ULL
+
+typedef struct SimulatedJob
+{
+    StepperManager *manager;
+    long moves;
+} SimulatedJob;
+
+static void simulatedJobLoop(void *ctx)
+{
+    SimulatedJob *job = (SimulatedJob *)ctx;
+    job->manager->run();
+    if(job->manager->distanceToGo() == 0)
+    {
+        long target = (job->moves % 2) ? 0 : 38000;
+        if(job->moves % 4 < 2)
+            job->manager->moveToAbsolute(target);
+        else
+            job->manager->moveProfiled(target);
+        job->moves++;
+    }
+}
+
+static void runSimulationBenchmarks()
+{
+    AccelStepper stepper(AccelStepper::DRIVER, 40, 41);
+    VirtualStepperDriver driver(40, 41);
+    driver.setTravel(-500, 40500);
+    driver.setMaxStepRate(20000);
+    driver.setLowSwitch(42, -200);
+    driver.setHighSwitch(43, 40200);
+    driver.begin();
+    LimitSwitch low(42), high(43);
+    low.beginInterrupt();
+    high.beginInterrupt();
+
+    StepperManager manager(&stepper);
+    manager.setLimitSwitches(&low, &high);
+    manager.setMaxSpeed(8000);
+    manager.setAcceleration(16000);
+    StepProfile profile;
+    profile.setMaxSpeed(8000);
+    profile.setAcceleration(16000);
+    manager.setProfile(&profile);
+    SimulatedJob job = {&manager, 0};
+    Simulation simulation;
+    simulation.watch(&manager);
+
+    unsigned long long start = Bench::counterNs();
+    unsigned long long simulated = simulation.run(simulatedJobLoop, &job, SIMULATED_JOB_MICROS);
+    double wallSeconds = (Bench::counterNs() - start) / 1e9;
+
+    Bench::reportValue("stepper_simulated_job_minutes", "minutes", simulated / 60e6);
+    Bench::reportValue("stepper_simulated_job_speedup", "x_real_time", simulated / 1e6 / wallSeconds);
+    Bench::reportValue("stepper_simulated_job_iterations", "loops", simulation.getIterations());
+    Bench::reportValue("stepper_simulated_job_moves", "moves", job.moves);
+    Bench::reportValue("stepper_simulated_job_steps", "steps", driver.getStepCount());
+    Bench::reportValue("stepper_simulated_job_position_error", "steps", labs(driver.getPosition() - manager.currentPosition()));
+    Bench::reportValue("stepper_simulated_job_lost_steps", "steps", driver.getLostSteps());
+}
+
+static void runPathBenchmarks()
+{
+    double stopping = runPathJob(false);
+    double planned = runPathJob(true);
+    Bench::reportValue("stepper_path_job_stop_each", "seconds", stopping);
+    Bench::reportValue("stepper_path_job_planner", "seconds", planned);
+}
+#endif
+
+void runStepperBenchmarks()
+{
+    AccelStepper stepper(AccelStepper::DRIVER, 2, 3);
+    StepperManager manager(&stepper);
+    manager.setMaxSpeed(10000);
+    manager.setAcceleration(20000);
+
+    // Slow enough that nearly every call is just the "not time yet" check
+    manager.moveAtSpeed(1);
+    Bench::run("stepper_run_speed_poll", stepperRun, &manager);
+
+    StepperManager limited(&stepper, limitNeverHit, LIMIT_HIGH);
+    limited.moveAtSpeed(1);
+    Bench::run("stepper_run_speed_poll_limit", stepperRun, &limited);
+
+    // Same again with the limit cached by an interrupt instead of read every call
+    LimitSwitch lowSwitch(20);
+    LimitSwitch highSwitch(21);
+    lowSwitch.beginInterrupt();
+    highSwitch.beginInterrupt();
+    StepperManager switched(&stepper);
+    switched.setLimitSwitches(&lowSwitch, &highSwitch);
+    switched.moveAtSpeed(1);
+    Bench::run("stepper_run_speed_poll_switch", stepperRun, &switched);
+
+    manager.setCurrentPosition(0);
+    manager.moveAtSpeed(10000);
+    Bench::run("stepper_run_speed_step", stepperRunStepping, &manager);
+
+    limited.setCurrentPosition(0);
+    limited.moveAtSpeed(10000);
+    Bench::run("stepper_run_speed_step_limit", stepperRunStepping, &limited);
+
+    switched.setCurrentPosition(0);
+    switched.moveAtSpeed(10000);
+    Bench::run("stepper_run_speed_step_switch", stepperRunStepping, &switched);
+    switched.stop();
+
+#if FIRMWORK_TELEMETRY
+    // Cost of a sample every step
+    static StepperTelemetry telemetry;
+    manager.setTelemetry(&telemetry);
+    manager.setCurrentPosition(0);
+    manager.moveAtSpeed(10000);
+    Bench::run("stepper_run_speed_step_telemetry", stepperRunStepping, &manager);
+    manager.setTelemetry(nullptr);
+#endif
+
+    // Accelerating move, every step goes through computeNewSpeed()
+    manager.setCurrentPosition(0);
+    manager.moveToAbsolute(100000000);
+    Bench::run("stepper_run_accel_step", stepperRunStepping, &manager);
+
+    manager.stop();
+    manager.setCurrentPosition(0);
+
+    // Same move off a precomputed table
+    StepProfile profile;
+    profile.setMaxSpeed(10000);
+    profile.setAcceleration(20000);
+    manager.setProfile(&profile);
+    manager.moveProfiled(100000000);
+    Bench::run("stepper_run_profile_step", stepperRunStepping, &manager);
+    manager.stop();
+    manager.setCurrentPosition(0);
+
+    profile.setShape(STEP_PROFILE_SCURVE);
+    profile.setJerk(200000);
+    manager.moveProfiled(100000000);
+    Bench::run("stepper_run_scurve_step", stepperRunStepping, &manager);
+    manager.stop();
+    manager.setCurrentPosition(0);
+
+    runStepPathBenchmarks();
+    runGroupBenchmarks();
+#if !defined(ESP_PLATFORM)
+    runPathBenchmarks();
+    runBlockingBenchmarks();
+    runHomingBenchmarks();
+    runSimulationBenchmarks();
+#endif
+}
@@ -0,0 +1,350 @@
+//
+// Created by Andrew Simmons on 10/15/26.
+//
+
+#include "Bench.h"
+#include "Timer.h"
+#include "TimerScheduler.h"
+#include "TimerPool.h"
+
+#define BENCH_TIMER_COUNT 60
+
+static volatile unsigned long long timerSink = 0;
+
+static void onTrigger(unsigned long long triggerCount, Timer *)
+{
+    timerSink += triggerCount;
+}
+
+// What a raw function pointer forces on anything with state: a global table to find the owner
+#define BENCH_OWNER_COUNT 8
+
+typedef struct TimerOwner
+{
+    Timer *timer;
+    unsigned long long count;
+} TimerOwner;
+
+static TimerOwner owners[BENCH_OWNER_COUNT];
+
+static void onOwnerTrigger(unsigned long long triggerCount, Timer *timer)
+{
+    for(byte i = 0; i < BENCH_OWNER_COUNT; i++)
+    {
+        if(owners[i].timer == timer)
+        {
+            owners[i].count += triggerCount;
+            return;
+        }
+    }
+}
+
+static void timerUpdate(void *ctx, unsigned long)
+{
+    ((Timer *)ctx)->update();
+}
+
+static void timerUpdateAt(void *ctx, unsigned long i)
+{
+    ((Timer *)ctx)->update(i + 1);
+}
+
+typedef struct TimerSet
+{
+    Timer *timers[BENCH_TIMER_COUNT];
+    TimerScheduler *scheduler;
+    unsigned long long now;
+} TimerSet;
+
+// One loop() worth, 1ms passes per call
+static void pollTimers(void *ctx, unsigned long)
+{
+    TimerSet *set = (TimerSet *)ctx;
+    set->now++;
+    for(byte t = 0; t < BENCH_TIMER_COUNT; t++)
+        set->timers[t]->update(set->now);
+}
+
+static void schedulerUpdate(void *ctx, unsigned long)
+{
+    TimerSet *set = (TimerSet *)ctx;
+    set->now++;
+    set->scheduler->update(set->now);
+}
+
+// Waking from a 1s idle on the micros clock, the only timer due is the one that set the wake
+static void schedulerIdleWake(void *ctx, unsigned long)
+{
+    TimerSet *set = (TimerSet *)ctx;
+    set->now += 1000000;
+    set->scheduler->update(set->now);
+}
+
+// Startup: the same task table built from new'ed timers vs a static pool
+static constexpr TimerTask bootTasks[] = {
+        {10, onTrigger, true}, {20, onTrigger, true}, {50, onTrigger, true}, {100, onTrigger, true},
+        {100, onTrigger, true}, {200, onTrigger, true}, {250, onTrigger, true}, {500, onTrigger, true},
+        {1000, onTrigger, true}, {1000, onTrigger, true}, {5000, onTrigger, false}, {60000, onTrigger, true},
+};
+#define BOOT_TASK_COUNT (sizeof(bootTasks) / sizeof(bootTasks[0]))
+
+static void bootHeap(void *, unsigned long)
+{
+    TimerScheduler scheduler;
+    Timer *timers[BOOT_TASK_COUNT];
+    for(byte t = 0; t < BOOT_TASK_COUNT; t++)
+    {
+        timers[t] = new Timer(0);
+        timers[t]->setDelayMSec(bootTasks[t].periodMSec);
+        timers[t]->setTriggerFunction(bootTasks[t].callback);
+        timers[t]->setEnabled(bootTasks[t].enabled);
+        scheduler.add(timers[t]);
+    }
+    for(byte t = 0; t < BOOT_TASK_COUNT; t++)
+        delete timers[t];
+}
+
+static void bootPool(void *, unsigned long)
+{
+    TimerScheduler scheduler;
+    TimerPool<BOOT_TASK_COUNT> pool;
+    pool.load(bootTasks, &scheduler);
+}
+
+static void poolUpdate(void *ctx, unsigned long i)
+{
+    ((TimerPool<BENCH_TIMER_COUNT> *)ctx)->update(i + 1);
+}
+
+static void nextDeadline(void *ctx, unsigned long)
+{
+    timerSink += ((TimerScheduler *)ctx)->getNextDeadline();
+}
+
+static void makeTimerSet(TimerSet *set, Timer *storage, TimerScheduler *scheduler)
+{
+    // The mix we actually run, lots of 100/200/1000ms timers and a few fast ones
+    static const unsigned int periods[] = {10, 20, 50, 100, 100, 200, 250, 500, 1000, 1000, 5000, 60000};
+    set->scheduler = scheduler;
+    set->now = 0;
+    for(byte t = 0; t < BENCH_TIMER_COUNT; t++)
+    {
+        Timer *timer = &storage[t];
+        timer->setDelayMSec(periods[t % (sizeof(periods) / sizeof(periods[0]))]);
+        timer->setTriggerFunction(onTrigger);
+        set->timers[t] = timer;
+        if(scheduler != nullptr)
+            scheduler->add(timer);
+    }
+}
+
+// Timeouts done the old way, a one-shot that turns itself off and stays on the wheel
+static void onTimeoutDisable(unsigned long long triggerCount, Timer *timer)
+{
+    timerSink += triggerCount;
+    timer->setEnabled(false);
+}
+
+static void onTimeout(unsigned long long triggerCount, Timer *)
+{
+    timerSink += triggerCount;
+}
+
+static void makeTimeouts(TimerSet *set, Timer *storage, TimerScheduler *scheduler, bool oneShot)
+{
+    makeTimerSet(set, storage, scheduler);
+    // 3 in 4 are timeouts that have already gone off
+    for(byte t = 0; t < BENCH_TIMER_COUNT; t++)
+    {
+        if(t % 4 == 0)
+            continue;
+        storage[t].setTriggerFunction(oneShot ? onTimeout : onTimeoutDisable);
+        if(oneShot)
+            storage[t].setOneShot();
+    }
+    for(unsigned int ms = 0; ms < 60000; ms++)
+        schedulerUpdate(set, ms);
+}
+
+// A minute of the usual mix ms by ms, worst number of callbacks any one update() has to run
+static void runStaggerBenchmark(const char *name, bool stagger)
+{
+    static const unsigned int periods[] = {10, 20, 50, 100, 100, 200, 250, 500, 1000, 1000, 5000, 60000};
+    static Timer timers[BENCH_TIMER_COUNT] = {
+#define T Timer(TimerDuration::fromMillis(1), &FakeTimerClock)
+            T, T, T, T, T, T, T, T, T, T, T, T, T, T, T, T, T, T, T, T,
+            T, T, T, T, T, T, T, T, T, T, T, T, T, T, T, T, T, T, T, T,
+            T, T, T, T, T, T, T, T, T, T, T, T, T, T, T, T, T, T, T, T,
+#undef T
+    };
+    FakeClock::set(0);
+    TimerScheduler scheduler(&FakeTimerClock);
+    scheduler.setStagger(stagger);
+    for(byte t = 0; t < BENCH_TIMER_COUNT; t++)
+    {
+        timers[t].setDelayMSec(periods[t % (sizeof(periods) / sizeof(periods[0]))]);
+        timers[t].setRateMode(TIMER_FIXED_RATE);
+        timers[t].setTriggerFunction(onTrigger);
+        timers[t].setLastTriggerTicks(0);
+        scheduler.add(&timers[t]);
+    }
+
+    unsigned int worstFired = 0;
+    for(unsigned long ms = 0; ms < 60000; ms++)
+    {
+        FakeClock::advance(1000);
+        unsigned int fired = scheduler.update();
+        if(fired > worstFired)
+            worstFired = fired;
+    }
+    char label[64];
+    snprintf(label, sizeof(label), "%s_max_fired", name);
+    Bench::reportValue(label, "callbacks", worstFired);
+    if(stagger)
+    {
+        snprintf(label, sizeof(label), "%s_max_slot_load", name);
+        Bench::reportValue(label, "callbacks", scheduler.getMaxSlotLoad());
+    }
+    for(byte t = 0; t < BENCH_TIMER_COUNT; t++)
+        scheduler.remove(&timers[t]);
+}
+
+#if FIRMWORK_TIMER_STATS
+// A 1ms control timer sharing the loop with a callback that hogs it for 3ms every 50ms
+static void onHog(unsigned long long, Timer *)
+{
+    delayMicroseconds(3000);
+}
+
+static void runStatsBenchmark()
+{
+    // Micros clock, that's what delayMicroseconds() moves on the host
+    TimerScheduler scheduler(&MicrosClock);
+    Timer control(TimerDuration::fromMillis(1), &MicrosClock);
+    control.setRateMode(TIMER_FIXED_RATE);
+    control.setTriggerFunction(onTrigger);
+    Timer hog(TimerDuration::fromMillis(50), &MicrosClock);
+    hog.setTriggerFunction(onHog);
+    scheduler.add(&control);
+    scheduler.add(&hog);
+    control.restart();
+    hog.restart();
+    for(unsigned long i = 0; i < 10000; i++)
+    {
+        Bench::advanceMicros(100);
+        scheduler.update();
+    }
+    const TimerStats &stats = control.getStats();
+    Bench::reportValue("timer_stats_control_late_max", "micros", (double)stats.getLateMax());
+    Bench::reportValue("timer_stats_control_deadline_misses", "count", stats.getDeadlineMisses());
+    Bench::reportValue("timer_stats_control_missed_periods", "count", (double)stats.getMissedPeriods());
+    Bench::reportValue("timer_stats_hog_exec_max", "micros", hog.getStats().getExecMax());
+    scheduler.printStats();
+}
+#endif
+
+void runTimerBenchmarks()
+{
+    Timer idle(1000000);
+    idle.setTriggerFunction(onTrigger);
+    idle.restart();
+    Bench::run("timer_update_not_due", timerUpdate, &idle);
+
+    Timer fires(0);
+    fires.setTriggerFunction(onTrigger);
+    Bench::run("timer_update_fire", timerUpdateAt, &fires);
+
+    Timer disabled(0);
+    disabled.setTriggerFunction(onTrigger);
+    disabled.setEnabled(false);
+    Bench::run("timer_update_disabled", timerUpdateAt, &disabled);
+
+    Timer fixedRate(1);
+    fixedRate.setTriggerFunction(onTrigger);
+    fixedRate.setRateMode(TIMER_FIXED_RATE);
+    Bench::run("timer_update_fixed_rate", timerUpdateAt, &fixedRate);
+
+    // Same work done through the global table vs a lambda holding its owner
+    Timer tabled[BENCH_OWNER_COUNT] = {Timer(0), Timer(0), Timer(0), Timer(0), Timer(0), Timer(0), Timer(0), Timer(0)};
+    for(byte i = 0; i < BENCH_OWNER_COUNT; i++)
+    {
+        owners[i].timer = &tabled[i];
+        owners[i].count = 0;
+        tabled[i].setTriggerFunction(onOwnerTrigger);
+    }
+    Bench::run("timer_fire_table_lookup", timerUpdateAt, &tabled[BENCH_OWNER_COUNT - 1]);
+
+    TimerOwner owner = {nullptr, 0};
+    Timer captured(0);
+    captured.setTriggerFunction([&owner](unsigned long long triggerCount, Timer *) {
+        owner.count += triggerCount;
+    });
+    Bench::run("timer_fire_lambda", timerUpdateAt, &captured);
+    timerSink += owner.count + owners[BENCH_OWNER_COUNT - 1].count;
+
+    static Timer polled[BENCH_TIMER_COUNT] = {
+#define T Timer(0)
+            T, T, T, T, T, T, T, T, T, T, T, T, T, T, T, T, T, T, T, T,
+            T, T, T, T, T, T, T, T, T, T, T, T, T, T, T, T, T, T, T, T,
+            T, T, T, T, T, T, T, T, T, T, T, T, T, T, T, T, T, T, T, T,
+    };
+    static Timer wheeled[BENCH_TIMER_COUNT] = {
+            T, T, T, T, T, T, T, T, T, T, T, T, T, T, T, T, T, T, T, T,
+            T, T, T, T, T, T, T, T, T, T, T, T, T, T, T, T, T, T, T, T,
+            T, T, T, T, T, T, T, T, T, T, T, T, T, T, T, T, T, T, T, T,
+#undef T
+    };
+    TimerSet set;
+    makeTimerSet(&set, polled, nullptr);
+    Bench::run("timer_poll_60", pollTimers, &set);
+
+    TimerScheduler scheduler;
+    makeTimerSet(&set, wheeled, &scheduler);
+    Bench::run("timer_scheduler_60", schedulerUpdate, &set);
+    Bench::run("timer_next_deadline_60", nextDeadline, &scheduler);
+
+    static Timer disabling[BENCH_TIMER_COUNT] = {
+#define T Timer(0)
+            T, T, T, T, T, T, T, T, T, T, T, T, T, T, T, T, T, T, T, T,
+            T, T, T, T, T, T, T, T, T, T, T, T, T, T, T, T, T, T, T, T,
+            T, T, T, T, T, T, T, T, T, T, T, T, T, T, T, T, T, T, T, T,
+    };
+    static Timer oneShots[BENCH_TIMER_COUNT] = {
+            T, T, T, T, T, T, T, T, T, T, T, T, T, T, T, T, T, T, T, T,
+            T, T, T, T, T, T, T, T, T, T, T, T, T, T, T, T, T, T, T, T,
+            T, T, T, T, T, T, T, T, T, T, T, T, T, T, T, T, T, T, T, T,
+#undef T
+    };
+    TimerScheduler disablingScheduler;
+    makeTimeouts(&set, disabling, &disablingScheduler, false);
+    Bench::run("timer_scheduler_dead_timeouts", schedulerUpdate, &set);
+    TimerScheduler oneShotScheduler;
+    makeTimeouts(&set, oneShots, &oneShotScheduler, true);
+    Bench::run("timer_scheduler_one_shots", schedulerUpdate, &set);
+    Bench::reportValue("timer_scheduler_one_shots_left", "timers", oneShotScheduler.getTimerCount());
+
+    TimerScheduler idleScheduler(&MicrosClock);
+    Timer wake(TimerDuration::fromMillis(1000), &MicrosClock);
+    wake.setRateMode(TIMER_FIXED_RATE);
+    wake.setTriggerFunction(onTrigger);
+    wake.setLastTriggerTicks(0);
+    idleScheduler.add(&wake);
+    TimerSet idleSet = {{}, &idleScheduler, 0};
+    Bench::run("timer_scheduler_idle_wake_1s", schedulerIdleWake, &idleSet, 4096);
+    idleScheduler.remove(&wake);
+
+#if FIRMWORK_TIMER_STATS
+    runStatsBenchmark();
+#endif
+
+    runStaggerBenchmark("timer_scheduler_aligned", false);
+    runStaggerBenchmark("timer_scheduler_staggered", true);
+
+    Bench::run("timer_boot_heap_12", bootHeap, nullptr, 4096);
+    Bench::run("timer_boot_pool_12", bootPool, nullptr, 4096);
+
+    static TimerPool<BENCH_TIMER_COUNT> pool;
+    for(byte t = 0; t < BENCH_TIMER_COUNT; t++)
+        pool.acquire(bootTasks[t % BOOT_TASK_COUNT]);
+    Bench::run("timer_pool_poll_60", poolUpdate, &pool);
+}
@@ -0,0 +1,21 @@
+//
+// Created by Andrew Simmons on 10/15/26.
+//
+
+#include <Arduino.h>
+#include "Bench.h"
+
+void setup()
+{
+    Serial.begin(115200);
+    runTimerBenchmarks();
+    runStepperBenchmarks();
+    runMathBenchmarks();
+    runGcodeBenchmarks();
+    Bench::finish();
+}
+
+void loop()
+{
+    delay(1000);
+}
@@ -0,0 +1,316 @@
+//
+// Created by Andrew Simmons on 10/15/26.
+//
+
+#include "AccelStepper.h"
+
+AccelStepper::AccelStepper(uint8_t interface, uint8_t pin1, uint8_t pin2, uint8_t pin3, uint8_t pin4, bool enable)
+{
+    _interface = interface;
+    _pin[0] = pin1;
+    _pin[1] = pin2;
+    _pin[2] = pin3;
+    _pin[3] = pin4;
+    if(enable)
+        enableOutputs();
+    setAcceleration(1);
+}
+
+AccelStepper::AccelStepper(void (*forward)(), void (*backward)())
+{
+    _interface = FUNCTION;
+    _forward = forward;
+    _backward = backward;
+    for(byte i = 0; i < 4; i++)
+        _pin[i] = 0;
+    setAcceleration(1);
+}
+
+void AccelStepper::moveTo(long absolute)
+{
+    if(_targetPos != absolute)
+    {
+        _targetPos = absolute;
+        computeNewSpeed();
+    }
+}
+
+void AccelStepper::move(long relative)
+{
+    moveTo(_currentPos + relative);
+}
+
+boolean AccelStepper::runSpeed()
+{
+    if(!_stepInterval)
+        return false;
+
+    // 32 bit like the real core, so the subtraction wraps with micros()
+    uint32_t time = micros();
+    if((uint32_t)(time - _lastStepTime) >= _stepInterval)
+    {
+        if(_direction == DIRECTION_CW)
+            _currentPos += 1;
+        else
+            _currentPos -= 1;
+        step(_currentPos);
+        _lastStepTime = time;
+        return true;
+    }
+    return false;
+}
+
+boolean AccelStepper::run()
+{
+    if(runSpeed())
+        computeNewSpeed();
+    return _speed != 0.0 || distanceToGo() != 0;
+}
+
+// n counts steps into the ramp, negative while decelerating. cn is the next step interval.
+unsigned long AccelStepper::computeNewSpeed()
+{
+    long distanceTo = distanceToGo();
+    long stepsToStop = (long)((_speed * _speed) / (2.0 * _acceleration));
+
+    if(distanceTo == 0 && stepsToStop <= 1)
+    {
+        _stepInterval = 0;
+        _speed = 0.0;
+        _n = 0;
+        return _stepInterval;
+    }
+
+    if(distanceTo > 0)
+    {
+        if(_n > 0)
+        {
+            if(stepsToStop >= distanceTo || _direction == DIRECTION_CCW)
+                _n = -stepsToStop;
+        }
+        else if(_n < 0)
+        {
+            if(stepsToStop < distanceTo && _direction == DIRECTION_CW)
+                _n = -_n;
+        }
+    }
+    else if(distanceTo < 0)
+    {
+        if(_n > 0)
+        {
+            if(stepsToStop >= -distanceTo || _direction == DIRECTION_CW)
+                _n = -stepsToStop;
+        }
+        else if(_n < 0)
+        {
+            if(stepsToStop < -distanceTo && _direction == DIRECTION_CCW)
+                _n = -_n;
+        }
+    }
+
+    if(_n == 0)
+    {
+        _cn = _c0;
+        _direction = distanceTo > 0 ? DIRECTION_CW : DIRECTION_CCW;
+    }
+    else
+    {
+        _cn = _cn - ((2.0 * _cn) / ((4.0 * _n) + 1));
+        if(_cn < _cmin)
+            _cn = _cmin;
+    }
+    _n++;
+    _stepInterval = _cn;
+    _speed = 1000000.0 / _cn;
+    if(_direction == DIRECTION_CCW)
+        _speed = -_speed;
+    return _stepInterval;
+}
+
+void AccelStepper::setMaxSpeed(float speed)
+{
+    if(speed < 0.0)
+        speed = -speed;
+    if(_maxSpeed != speed)
+    {
+        _maxSpeed = speed;
+        _cmin = 1000000.0 / speed;
+        if(_n > 0)
+        {
+            _n = (long)((_speed * _speed) / (2.0 * _acceleration));
+            computeNewSpeed();
+        }
+    }
+}
+
+float AccelStepper::maxSpeed()
+{
+    return _maxSpeed;
+}
+
+void AccelStepper::setAcceleration(float acceleration)
+{
+    if(acceleration == 0.0)
+        return;
+    if(acceleration < 0.0)
+        acceleration = -acceleration;
+    if(_acceleration != acceleration)
+    {
+        if(_acceleration != 0.0)
+            _n = _n * (_acceleration / acceleration);
+        _c0 = 0.676 * sqrt(2.0 / acceleration) * 1000000.0;
+        _acceleration = acceleration;
+        computeNewSpeed();
+    }
+}
+
+float AccelStepper::acceleration()
+{
+    return _acceleration;
+}
+
+void AccelStepper::setSpeed(float speed)
+{
+    if(speed == _speed)
+        return;
+    if(speed > _maxSpeed)
+        speed = _maxSpeed;
+    else if(speed < -_maxSpeed)
+        speed = -_maxSpeed;
+
+    if(speed == 0.0)
+    {
+        _stepInterval = 0;
+    }
+    else
+    {
+        _stepInterval = fabs(1000000.0 / speed);
+        _direction = speed > 0.0 ? DIRECTION_CW : DIRECTION_CCW;
+    }
+    _speed = speed;
+}
+
+float AccelStepper::speed()
+{
+    return _speed;
+}
+
+long AccelStepper::distanceToGo()
+{
+    return _targetPos - _currentPos;
+}
+
+long AccelStepper::targetPosition()
+{
+    return _targetPos;
+}
+
+long AccelStepper::currentPosition()
+{
+    return _currentPos;
+}
+
+void AccelStepper::setCurrentPosition(long position)
+{
+    _targetPos = _currentPos = position;
+    _n = 0;
+    _stepInterval = 0;
+    _speed = 0.0;
+}
+
+// Blocking helpers spin on the virtual clock, otherwise they'd never finish
+void AccelStepper::runToPosition()
+{
+    while(run())
+        VirtualClock::advance(1);
+}
+
+boolean AccelStepper::runSpeedToPosition()
+{
+    if(_targetPos == _currentPos)
+        return false;
+    if(_targetPos > _currentPos)
+        _direction = DIRECTION_CW;
+    else
+        _direction = DIRECTION_CCW;
+    return runSpeed();
+}
+
+void AccelStepper::runToNewPosition(long position)
+{
+    moveTo(position);
+    runToPosition();
+}
+
+void AccelStepper::stop()
+{
+    if(_speed != 0.0)
+    {
+        long stepsToStop = (long)((_speed * _speed) / (2.0 * _acceleration)) + 1;
+        if(_speed > 0)
+            move(stepsToStop);
+        else
+            move(-stepsToStop);
+    }
+}
+
+bool AccelStepper::isRunning()
+{
+    return !(_speed == 0.0 && _targetPos == _currentPos);
+}
+
+void AccelStepper::setMinPulseWidth(unsigned int minWidth)
+{
+    _minPulseWidth = minWidth;
+}
+
+void AccelStepper::setEnablePin(uint8_t enablePin)
+{
+    _enablePin = enablePin;
+    if(_enablePin != 0xff)
+    {
+        pinMode(_enablePin, OUTPUT);
+        digitalWrite(_enablePin, HIGH);
+    }
+}
+
+void AccelStepper::disableOutputs()
+{
+    if(_enablePin != 0xff)
+        digitalWrite(_enablePin, LOW);
+}
+
+void AccelStepper::enableOutputs()
+{
+    if(_interface == DRIVER)
+    {
+        pinMode(_pin[0], OUTPUT);
+        pinMode(_pin[1], OUTPUT);
+    }
+    if(_enablePin != 0xff)
+        digitalWrite(_enablePin, HIGH);
+}
+
+// Only DRIVER and FUNCTION wiring actually toggle anything, the coil modes just count
+void AccelStepper::step(long)
+{
+    stepCount++;
+    if(_interface == FUNCTION)
+    {
+        if(_direction == DIRECTION_CW)
+        {
+            if(_forward != nullptr)
+                _forward();
+        }
+        else if(_backward != nullptr)
+        {
+            _backward();
+        }
+    }
+    else if(_interface == DRIVER)
+    {
+        digitalWrite(_pin[1], _direction);
+        digitalWrite(_pin[0], HIGH);
+        digitalWrite(_pin[0], LOW);
+    }
+}
@@ -0,0 +1,95 @@
+//
+// Created by Andrew Simmons on 10/15/26.
+//
+
+// Host stand-in for waspinator/AccelStepper. Same public API and the same constant
+// acceleration stepping (Austin's "real time" algorithm), timed off VirtualClock through
+// micros(). Steps go to the pins/functions like the real one and are counted.
+
+#ifndef FIRMWORK_NATIVE_ACCELSTEPPER_H
+#define FIRMWORK_NATIVE_ACCELSTEPPER_H
+#include <Arduino.h>
+
+class AccelStepper
+{
+    public:
+        typedef enum
+        {
+            FUNCTION = 0,
+            DRIVER = 1,
+            FULL2WIRE = 2,
+            FULL3WIRE = 3,
+            FULL4WIRE = 4,
+            HALF3WIRE = 6,
+            HALF4WIRE = 8,
+        } MotorInterfaceType;
+
+        AccelStepper(uint8_t interface = AccelStepper::FULL4WIRE, uint8_t pin1 = 2, uint8_t pin2 = 3,
+                     uint8_t pin3 = 4, uint8_t pin4 = 5, bool enable = true);
+        AccelStepper(void (*forward)(), void (*backward)());
+        virtual ~AccelStepper() {}
+
+        void moveTo(long absolute);
+        void move(long relative);
+        boolean run();
+        boolean runSpeed();
+        void setMaxSpeed(float speed);
+        float maxSpeed();
+        void setAcceleration(float acceleration);
+        float acceleration();
+        void setSpeed(float speed);
+        float speed();
+        long distanceToGo();
+        long targetPosition();
+        long currentPosition();
+        void setCurrentPosition(long position);
+        void runToPosition();
+        boolean runSpeedToPosition();
+        void runToNewPosition(long position);
+        void stop();
+        bool isRunning();
+        void setMinPulseWidth(unsigned int minWidth);
+        void setEnablePin(uint8_t enablePin = 0xff);
+        void disableOutputs();
+        void enableOutputs();
+
+        // Host only
+        unsigned long getStepCount() const {return stepCount;}
+        unsigned long getLastStepTime() const {return _lastStepTime;}
+        unsigned long getStepInterval() const {return _stepInterval;}
+
+    protected:
+        typedef enum
+        {
+            DIRECTION_CCW = 0,
+            DIRECTION_CW = 1,
+        } Direction;
+
+        unsigned long computeNewSpeed();
+        virtual void step(long step);
+
+        boolean _direction = DIRECTION_CCW;
+
+    private:
+        uint8_t _interface;
+        uint8_t _pin[4];
+        uint8_t _enablePin = 0xff;
+        void (*_forward)() = nullptr;
+        void (*_backward)() = nullptr;
+        long _currentPos = 0;
+        long _targetPos = 0;
+        float _speed = 0.0;
+        float _maxSpeed = 1.0;
+        float _acceleration = 0.0;
+        unsigned long _stepInterval = 0;
+        uint32_t _lastStepTime = 0;
+        unsigned int _minPulseWidth = 1;
+        long _n = 0;
+        float _c0 = 0.0;
+        float _cn = 0.0;
+        float _cmin = 1000000.0;
+        unsigned long stepCount = 0;
+};
+
+
+#endif //FIRMWORK_NATIVE_ACCELSTEPPER_H
@@ -0,0 +1,132 @@
+//
+// Created by Andrew Simmons on 10/15/26.
+//
+
+#include "Arduino.h"
+#include <stdarg.h>
+
+NativeSerial Serial;
+
+unsigned long long VirtualClock::micros = 0;
+uint8_t VirtualPins::levels[NATIVE_PIN_COUNT];
+unsigned long VirtualPins::writes[NATIVE_PIN_COUNT];
+void (*VirtualPins::handlers[NATIVE_PIN_COUNT])(void *);
+void *VirtualPins::handlerArgs[NATIVE_PIN_COUNT];
+uint8_t VirtualPins::handlerModes[NATIVE_PIN_COUNT];
+
+unsigned long long VirtualClock::now()
+{
+    return micros;
+}
+
+void VirtualClock::set(unsigned long long pMicros)
+{
+    VirtualClock::micros = pMicros;
+}
+
+void VirtualClock::advance(unsigned long long pMicros)
+{
+    VirtualClock::micros += pMicros;
+}
+
+unsigned long millis()
+{
+    return (uint32_t)(VirtualClock::now() / 1000ULL);
+}
+
+unsigned long micros()
+{
+    return (uint32_t)VirtualClock::now();
+}
+
+// Nothing else runs on the host, so waiting is just moving the clock
+void delay(unsigned long ms)
+{
+    VirtualClock::advance(ms * 1000ULL);
+}
+
+void delayMicroseconds(unsigned int us)
+{
+    VirtualClock::advance(us);
+}
+
+void yield()
+{
+}
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+    if(pin < NATIVE_PIN_COUNT && mode == INPUT_PULLUP)
+        VirtualPins::set(pin, HIGH);
+}
+
+void digitalWrite(uint8_t pin, uint8_t val)
+{
+    if(pin >= NATIVE_PIN_COUNT)
+        return;
+    VirtualPins::set(pin, val);
+    VirtualPins::writes[pin]++;
+}
+
+int digitalRead(uint8_t pin)
+{
+    return VirtualPins::get(pin);
+}
+
+void VirtualPins::set(uint8_t pin, uint8_t val)
+{
+    if(pin >= NATIVE_PIN_COUNT)
+        return;
+    uint8_t level = val ? HIGH : LOW;
+    if(level == levels[pin])
+        return;
+    levels[pin] = level;
+    uint8_t mode = handlerModes[pin];
+    if(handlers[pin] != nullptr && (mode == CHANGE || (mode == RISING && level == HIGH) || (mode == FALLING && level == LOW)))
+        handlers[pin](handlerArgs[pin]);
+}
+
+// attachInterrupt()'s handler has no argument, it rides in the arg slot
+static void callPlainHandler(void *arg)
+{
+    ((void (*)(void))arg)();
+}
+
+void attachInterrupt(uint8_t pin, void (*handler)(void), int mode)
+{
+    attachInterruptArg(pin, callPlainHandler, (void *)handler, mode);
+}
+
+void attachInterruptArg(uint8_t pin, void (*handler)(void *), void *arg, int mode)
+{
+    if(pin >= NATIVE_PIN_COUNT)
+        return;
+    VirtualPins::handlers[pin] = handler;
+    VirtualPins::handlerArgs[pin] = arg;
+    VirtualPins::handlerModes[pin] = mode;
+}
+
+void detachInterrupt(uint8_t pin)
+{
+    if(pin < NATIVE_PIN_COUNT)
+        VirtualPins::handlers[pin] = nullptr;
+}
+
+uint8_t VirtualPins::get(uint8_t pin)
+{
+    return pin < NATIVE_PIN_COUNT ? levels[pin] : LOW;
+}
+
+unsigned long VirtualPins::getWriteCount(uint8_t pin)
+{
+    return pin < NATIVE_PIN_COUNT ? writes[pin] : 0;
+}
+
+size_t NativeSerial::printf(const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    int n = vprintf(format, args);
+    va_end(args);
+    return n < 0 ? 0 : n;
+}
@@ -0,0 +1,112 @@
+//
+// Created by Andrew Simmons on 10/15/26.
+//
+
+// Just enough Arduino for the library to build and run on the host (env:native).
+// Time is virtual, it only moves when something advances it, so runs are repeatable.
+
+#ifndef FIRMWORK_NATIVE_ARDUINO_H
+#define FIRMWORK_NATIVE_ARDUINO_H
+#include <stdint.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 0x1
+#define LOW 0x0
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+#define RISING 0x01
+#define FALLING 0x02
+#define CHANGE 0x03
+#define NATIVE_PIN_COUNT 64
+// No flash cache to dodge on the host
+#define IRAM_ATTR
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+inline void noInterrupts() {}
+inline void interrupts() {}
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+// Handlers run inline from whatever changes the pin level (VirtualPins::set or digitalWrite)
+#define digitalPinToInterrupt(pin) (pin)
+void attachInterrupt(uint8_t pin, void (*handler)(void), int mode);
+void attachInterruptArg(uint8_t pin, void (*handler)(void *), void *arg, int mode);
+void detachInterrupt(uint8_t pin);
+
+// The clock behind millis()/micros(). Full 64 bit micros, millis()/micros() truncate
+// to 32 bits like the real thing so wraps can be tested.
+class VirtualClock
+{
+    public:
+        static unsigned long long now();
+        static void set(unsigned long long pMicros);
+        static void advance(unsigned long long pMicros);
+    private:
+        static unsigned long long micros;
+};
+
+// Pin levels behind digitalRead()/digitalWrite(), so tests can fake switches and watch outputs
+class VirtualPins
+{
+    friend void digitalWrite(uint8_t pin, uint8_t val);
+    public:
+        static void set(uint8_t pin, uint8_t val);
+        static uint8_t get(uint8_t pin);
+        static unsigned long getWriteCount(uint8_t pin);
+    private:
+        static uint8_t levels[NATIVE_PIN_COUNT];
+        static unsigned long writes[NATIVE_PIN_COUNT];
+        friend void attachInterruptArg(uint8_t pin, void (*handler)(void *), void *arg, int mode);
+        friend void detachInterrupt(uint8_t pin);
+        static void (*handlers[NATIVE_PIN_COUNT])(void *);
+        static void *handlerArgs[NATIVE_PIN_COUNT];
+        static uint8_t handlerModes[NATIVE_PIN_COUNT];
+};
+
+// Just the reading half of Arduino's Stream
+class Stream
+{
+    public:
+        virtual ~Stream() {}
+        virtual int available() = 0;
+        virtual int read() = 0;
+        virtual int peek() = 0;
+};
+
+// Output only, there's nothing to read on the host
+class NativeSerial : public Stream
+{
+    public:
+        int available() override { return 0; }
+        int read() override { return -1; }
+        int peek() override { return -1; }
+        void begin(unsigned long) {}
+        void flush() { fflush(stdout); }
+        size_t print(const char *s) { return fputs(s, stdout) >= 0 ? strlen(s) : 0; }
+        size_t print(long n) { return printf("%ld", n); }
+        size_t print(unsigned long n) { return printf("%lu", n); }
+        size_t print(int n) { return printf("%d", n); }
+        size_t print(unsigned int n) { return printf("%u", n); }
+        size_t print(double n, int digits = 2) { return printf("%.*f", digits, n); }
+        size_t println() { return print("\n"); }
+        template<typename T> size_t println(T v) { size_t n = print(v); return n + println(); }
+        size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+};
+
+extern NativeSerial Serial;
+
+
+#endif //FIRMWORK_NATIVE_ARDUINO_H
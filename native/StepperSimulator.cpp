@@ -0,0 +1,212 @@
+//
+// Created by Andrew Simmons on 10/15/26.
+//
+
+#include "StepperSimulator.h"
+
+VirtualStepperDriver::VirtualStepperDriver(uint8_t stepPin, uint8_t dirPin, bool dirHighIsForward) :
+        stepPin(stepPin), dirPin(dirPin), dirHighIsForward(dirHighIsForward)
+{
+
+}
+
+VirtualStepperDriver::~VirtualStepperDriver()
+{
+    end();
+}
+
+void VirtualStepperDriver::begin()
+{
+    attachInterruptArg(stepPin, onStepEdge, this, RISING);
+    updateSwitches();
+}
+
+void VirtualStepperDriver::end()
+{
+    detachInterrupt(stepPin);
+}
+
+void VirtualStepperDriver::setTravel(long min, long max)
+{
+    travelMin = min;
+    travelMax = max;
+}
+
+void VirtualStepperDriver::setMaxStepRate(float stepsPerSecond)
+{
+    minStepMicros = stepsPerSecond > 0 ? (unsigned long long)(1000000.0f / stepsPerSecond) : 0;
+}
+
+void VirtualStepperDriver::setLowSwitch(uint8_t pin, long at, uint8_t activeLevel)
+{
+    lowSwitchPin = pin;
+    lowSwitchAt = at;
+    lowActive = activeLevel;
+    updateSwitches();
+}
+
+void VirtualStepperDriver::setHighSwitch(uint8_t pin, long at, uint8_t activeLevel)
+{
+    highSwitchPin = pin;
+    highSwitchAt = at;
+    highActive = activeLevel;
+    updateSwitches();
+}
+
+void VirtualStepperDriver::setPosition(long pPosition)
+{
+    position = pPosition;
+    updateSwitches();
+}
+
+void VirtualStepperDriver::onStepEdge(void *arg)
+{
+    ((VirtualStepperDriver *)arg)->onStep();
+}
+
+void VirtualStepperDriver::onStep()
+{
+    unsigned long long now = VirtualClock::now();
+    bool forward = (VirtualPins::get(dirPin) == HIGH) == dirHighIsForward;
+    bool lost = false;
+
+    if(stepCount > 0)
+    {
+        unsigned long long interval = now - lastStepMicros;
+        if(interval < minInterval)
+            minInterval = interval;
+        lost = interval < minStepMicros;
+    }
+    if(!lost)
+    {
+        long next = position + (forward ? 1 : -1);
+        lost = next < travelMin || next > travelMax;
+        if(!lost)
+            position = next;
+    }
+    stepCount++;
+    if(lost)
+        lostSteps++;
+    lastStepMicros = now;
+
+    StepRecord *record = &capture[captureHead];
+    record->micros = now;
+    record->position = position;
+    record->forward = forward;
+    record->lost = lost;
+    captureHead = (captureHead + 1) % VIRTUAL_DRIVER_CAPTURE;
+    captureTotal++;
+
+    updateSwitches();
+}
+
+void VirtualStepperDriver::updateSwitches()
+{
+    if(lowSwitchPin >= 0)
+        VirtualPins::set(lowSwitchPin, position <= lowSwitchAt ? lowActive : !lowActive);
+    if(highSwitchPin >= 0)
+        VirtualPins::set(highSwitchPin, position >= highSwitchAt ? highActive : !highActive);
+}
+
+size_t VirtualStepperDriver::getCaptureCount() const
+{
+    return captureTotal < VIRTUAL_DRIVER_CAPTURE ? captureTotal : VIRTUAL_DRIVER_CAPTURE;
+}
+
+const StepRecord &VirtualStepperDriver::getCapture(size_t index) const
+{
+    size_t oldest = (captureHead + VIRTUAL_DRIVER_CAPTURE - getCaptureCount()) % VIRTUAL_DRIVER_CAPTURE;
+    return capture[(oldest + index) % VIRTUAL_DRIVER_CAPTURE];
+}
+
+void VirtualStepperDriver::clearCapture()
+{
+    captureHead = 0;
+    captureTotal = 0;
+}
+
+bool Simulation::watch(AccelStepper *stepper)
+{
+    if(stepperCount >= SIMULATION_MAX_STEPPERS)
+        return false;
+    steppers[stepperCount++] = stepper;
+    return true;
+}
+
+bool Simulation::watch(StepperManager *manager)
+{
+    if(managerCount >= SIMULATION_MAX_STEPPERS)
+        return false;
+    managers[managerCount++] = manager;
+    return true;
+}
+
+bool Simulation::watch(StepperGroup *group)
+{
+    if(groupCount >= SIMULATION_MAX_STEPPERS)
+        return false;
+    groups[groupCount++] = group;
+    return true;
+}
+
+// ULONG_MAX when it isn't stepping
+static unsigned long untilAccelStep(const AccelStepper *stepper, uint32_t now)
+{
+    unsigned long interval = stepper->getStepInterval();
+    if(interval == 0)
+        return ULONG_MAX;
+    uint32_t since = now - (uint32_t)stepper->getLastStepTime();
+    return since >= interval ? 1 : interval - since;
+}
+
+// Micros until the soonest watched step, capped at maxStepMicros
+unsigned long Simulation::nextJump()
+{
+    if(stepperCount == 0 && managerCount == 0 && groupCount == 0)
+        return 1;
+    unsigned long jump = maxStepMicros;
+    uint32_t now = micros();
+    for(byte i = 0; i < stepperCount; i++)
+    {
+        unsigned long until = untilAccelStep(steppers[i], now);
+        if(until < jump)
+            jump = until;
+    }
+    for(byte i = 0; i < managerCount; i++)
+    {
+        StepperMode mode = managers[i]->getMode();
+        if(mode == STEPPER_DIRECT || mode == STEPPER_QUEUED)
+            continue;
+        unsigned long until = managers[i]->getMicrosToNextStep();
+        if(until == UINT32_MAX)
+            until = untilAccelStep(managers[i]->getStepper(), now);
+        if(until < jump)
+            jump = until;
+    }
+    for(byte i = 0; i < groupCount; i++)
+    {
+        unsigned long until = groups[i]->getMicrosToNextStep();
+        if(until < jump)
+            jump = until;
+    }
+    return jump > 0 ? jump : 1;
+}
+
+unsigned long long Simulation::run(void (*loop)(void *), void *ctx, unsigned long long durationMicros,
+                                   bool (*done)(void *))
+{
+    unsigned long long start = VirtualClock::now();
+    unsigned long long end = start + durationMicros;
+    while(VirtualClock::now() < end)
+    {
+        loop(ctx);
+        iterations++;
+        if(done != nullptr && done(ctx))
+            break;
+        unsigned long long jump = nextJump();
+        if(VirtualClock::now() + jump > end)
+            jump = end - VirtualClock::now();
+        VirtualClock::advance(jump);
+    }
+    return VirtualClock::now() - start;
+}
@@ -0,0 +1,112 @@
+//
+// Created by Andrew Simmons on 10/15/26.
+//
+
+// Host only. The machine on the other end of the step/dir pins, and a loop that runs it fast.
+
+#ifndef FIRMWORK_NATIVE_STEPPERSIMULATOR_H
+#define FIRMWORK_NATIVE_STEPPERSIMULATOR_H
+#include <Arduino.h>
+#include <AccelStepper.h>
+#include <limits.h>
+#include "StepperManager.h"
+#include "StepperGroup.h"
+
+#define VIRTUAL_DRIVER_CAPTURE 4096
+#define SIMULATION_MAX_STEPPERS 8
+
+typedef struct StepRecord
+{
+    unsigned long long micros;
+    long position;  // mechanical, after the step
+    bool forward;
+    bool lost;      // hit a hard stop or came too fast for the motor
+} StepRecord;
+
+// A step/dir driver and the axis behind it. Listens for rising edges on the step pin, so it sees
+// steps from AccelStepper's DRIVER wiring and StepTimerBackend alike. Steps move the mechanical
+// position unless they'd go past a hard stop or come faster than the motor can follow, then
+// they're lost (like a real stall). Limit switches are pins driven off the mechanical position.
+class VirtualStepperDriver
+{
+    public:
+        VirtualStepperDriver(uint8_t stepPin, uint8_t dirPin, bool dirHighIsForward = true);
+        ~VirtualStepperDriver();
+        void begin();
+        void end();
+        // Hard stops, mechanical position never leaves [min, max]
+        void setTravel(long min, long max);
+        // Steps closer together than this are lost, 0 = no limit
+        void setMaxStepRate(float stepsPerSecond);
+        // Pin reads activeLevel while position <= at (low switch) or >= at (high switch)
+        void setLowSwitch(uint8_t pin, long at, uint8_t activeLevel = LOW);
+        void setHighSwitch(uint8_t pin, long at, uint8_t activeLevel = LOW);
+        void setPosition(long position);
+
+        long getPosition() const {return position;}
+        unsigned long getStepCount() const {return stepCount;}
+        unsigned long getLostSteps() const {return lostSteps;}
+        // Smallest gap between two steps seen, micros
+        unsigned long long getMinInterval() const {return minInterval;}
+        // Last VIRTUAL_DRIVER_CAPTURE steps, 0 is the oldest
+        size_t getCaptureCount() const;
+        const StepRecord &getCapture(size_t index) const;
+        void clearCapture();
+    private:
+        uint8_t stepPin;
+        uint8_t dirPin;
+        bool dirHighIsForward;
+        long position = 0;
+        long travelMin = LONG_MIN;
+        long travelMax = LONG_MAX;
+        unsigned long long minStepMicros = 0;
+        int lowSwitchPin = -1;
+        int highSwitchPin = -1;
+        long lowSwitchAt = 0;
+        long highSwitchAt = 0;
+        uint8_t lowActive = LOW;
+        uint8_t highActive = LOW;
+        unsigned long stepCount = 0;
+        unsigned long lostSteps = 0;
+        unsigned long long lastStepMicros = 0;
+        unsigned long long minInterval = ~0ULL;
+        StepRecord capture[VIRTUAL_DRIVER_CAPTURE];
+        size_t captureHead = 0;
+        unsigned long captureTotal = 0;
+        void onStep();
+        void updateSwitches();
+        static void onStepEdge(void *arg);
+};
+
+// Runs loop() against VirtualClock as fast as the host goes. With steppers watched, the clock
+// jumps straight to the next step any of them is due instead of ticking through the gaps, so long
+// jobs take seconds. Anything else that needs waking on time (timers, StepTimerBackend) caps the
+// jump with maxStepMicros.
+class Simulation
+{
+    public:
+        // A bare AccelStepper, timed off its own step interval
+        bool watch(AccelStepper *stepper);
+        // Whichever clock the mode steps off: AccelStepper's, or the profile's in PROFILE. DIRECT
+        // is up to whoever is stepping it (watch the StepperGroup) and QUEUED to the backend.
+        bool watch(StepperManager *manager);
+        bool watch(StepperGroup *group);
+        void setMaxStepMicros(unsigned long micros) {maxStepMicros = micros > 0 ? micros : 1;}
+        // Until done() says so or duration runs out, returns the virtual micros it took
+        unsigned long long run(void (*loop)(void *ctx), void *ctx, unsigned long long durationMicros,
+                               bool (*done)(void *ctx) = nullptr);
+        unsigned long getIterations() const {return iterations;}
+    private:
+        AccelStepper *steppers[SIMULATION_MAX_STEPPERS];
+        byte stepperCount = 0;
+        StepperManager *managers[SIMULATION_MAX_STEPPERS];
+        byte managerCount = 0;
+        StepperGroup *groups[SIMULATION_MAX_STEPPERS];
+        byte groupCount = 0;
+        unsigned long maxStepMicros = 1000;
+        unsigned long iterations = 0;
+        unsigned long nextJump();
+};
+
+
+#endif //FIRMWORK_NATIVE_STEPPERSIMULATOR_H
@@ -0,0 +1,21 @@
+//
+// Created by Andrew Simmons on 10/15/26.
+//
+
+#include "Arduino.h"
+
+// Same shape as the Arduino core's main, sketches that are done can just exit()
+void setup() __attribute__((weak));
+void loop() __attribute__((weak));
+
+#if !defined(PIO_UNIT_TESTING)
+int main()
+{
+    if(setup)
+        setup();
+    if(!loop)
+        return 0;
+    for(;;)
+        loop();
+}
+#endif
@@ -0,0 +1,140 @@
+//
+// Created by Andrew Simmons on 10/15/26.
+//
+
+#include "GcodeExecutor.h"
+
+GcodeExecutor::GcodeExecutor(GcodeParser *parser, MotionPlanner *planner, StepperGroup *group) :
+        parser(parser), planner(planner), group(group)
+{
+    // Only configured axes home, so the parser shouldn't reset the others on G28
+    parser->setHomingAxes(0);
+}
+
+void GcodeExecutor::setHoming(byte axis, const HomingConfig &config)
+{
+    if(axis >= GCODE_MAX_AXES)
+        return;
+    homingConfigs[axis] = config;
+    homingMask |= 1 << axis;
+    parser->setHomingAxes(homingMask);
+}
+
+bool GcodeExecutor::run()
+{
+    if(faulted)
+        return false;
+    if(homing)
+        return runHoming();
+
+    bool moving = planner->run();
+    if(planner->isFaulted())
+    {
+        abort();
+        return false;
+    }
+    while(true)
+    {
+        if(!hasCurrent)
+        {
+            if(!parser->pop(current))
+                break;
+            hasCurrent = true;
+        }
+
+        if(current.type == GCODE_MOVE)
+        {
+            // Group axes the parser has no mapper for stay where the planner already has them
+            for(byte i = 0; i < GCODE_MAX_AXES; i++)
+            {
+                if(!(current.axisMask & (1 << i)))
+                    current.target[i] = planner->getPlannedPosition(i);
+            }
+            // Planner full, keep hold of it and try again next run()
+            if(!planner->addLine(current.target, current.speed))
+                break;
+            hasCurrent = false;
+            continue;
+        }
+
+        if(!planner->isIdle())
+            break;
+        hasCurrent = false;
+        if(current.type == GCODE_HOME)
+        {
+            startHoming(current.axisMask);
+            return true;
+        }
+        if(mCodeFunction != nullptr)
+            mCodeFunction(current.code, current.value);
+    }
+    return moving || hasCurrent || !planner->isIdle();
+}
+
+void GcodeExecutor::startHoming(byte axisMask)
+{
+    homingAxes = 0;
+    bool started = true;
+    for(byte i = 0; i < group->getAxisCount() && i < GCODE_MAX_AXES; i++)
+    {
+        if(axisMask & homingMask & (1 << i))
+        {
+            started &= group->getStepper(i)->home(homingConfigs[i]);
+            homingAxes |= 1 << i;
+        }
+    }
+    homing = true;
+    if(!started)
+        abort();
+}
+
+bool GcodeExecutor::runHoming()
+{
+    bool still = false;
+    for(byte i = 0; i < group->getAxisCount(); i++)
+    {
+        StepperManager *manager = group->getStepper(i);
+        if(manager->isHoming())
+        {
+            manager->run();
+            still |= manager->isHoming();
+        }
+        // The rest of the program assumes this axis is at home, it isn't
+        if((homingAxes & (1 << i)) && manager->getHomingState() == HOMING_FAILED)
+        {
+            abort();
+            return false;
+        }
+    }
+    if(!still)
+    {
+        homing = false;
+        // The axes moved under the planner, start it from where they ended up
+        planner->syncPosition();
+    }
+    return true;
+}
+
+void GcodeExecutor::abort()
+{
+    for(byte i = 0; i < group->getAxisCount(); i++)
+    {
+        if(group->getStepper(i)->isHoming())
+            group->getStepper(i)->stop();
+    }
+    homing = false;
+    planner->hardStop();
+    hasCurrent = false;
+    GcodeCommand dropped;
+    while(parser->pop(dropped))
+    {
+    }
+    faulted = true;
+}
+
+void GcodeExecutor::clearFault()
+{
+    faulted = false;
+    planner->clearFault();
+    planner->syncPosition();
+}
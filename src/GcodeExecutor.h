@@ -0,0 +1,49 @@
+//
+// Created by Andrew Simmons on 10/15/26.
+//
+
+#ifndef FIRMWORK_GCODEEXECUTOR_H
+#define FIRMWORK_GCODEEXECUTOR_H
+#include <Arduino.h>
+#include "GcodeParser.h"
+#include "MotionPlanner.h"
+
+// Takes GcodeParser's commands and runs them: moves go into the MotionPlanner (so G1 chains flow
+// through corners), G28 and M-codes wait for motion to finish first, the same order the file has
+// them. G28 uses each axis' StepperManager::home(), all at once. A homing failure or a limit hit
+// mid move aborts the program: everything stops, whatever's queued is dropped, and nothing runs
+// until clearFault().
+class GcodeExecutor
+{
+    public:
+        GcodeExecutor(GcodeParser *parser, MotionPlanner *planner, StepperGroup *group);
+        // Axes without a config are left alone by G28. config.homePosition should be where the
+        // parser's homeMm for the axis maps to, that's where the parser thinks G28 left it.
+        void setHoming(byte axis, const HomingConfig &config);
+        // Pen up/down, spindle, whatever the M-codes mean on this machine
+        void setMCodeFunction(void (*pMCodeFunction)(int code, float value)) {mCodeFunction = pMCodeFunction;}
+        // Call from loop(). True while there's anything queued or moving.
+        bool run();
+        bool isHoming() const {return homing;}
+        bool isFaulted() const {return faulted;}
+        // The parser's positions are whatever the dropped lines left them at, home (G28) next
+        void clearFault();
+    private:
+        GcodeParser *parser;
+        MotionPlanner *planner;
+        StepperGroup *group;
+        HomingConfig homingConfigs[GCODE_MAX_AXES];
+        byte homingMask = 0;
+        byte homingAxes = 0;   // the ones this G28 started
+        bool homing = false;
+        bool faulted = false;
+        GcodeCommand current;
+        bool hasCurrent = false;
+        void (*mCodeFunction)(int code, float value) = nullptr;
+        bool runHoming();
+        void startHoming(byte axisMask);
+        void abort();
+};
+
+
+#endif //FIRMWORK_GCODEEXECUTOR_H
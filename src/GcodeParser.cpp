@@ -0,0 +1,266 @@
+//
+// Created by Andrew Simmons on 10/15/26.
+//
+
+#include "GcodeParser.h"
+
+GcodeParser::GcodeParser()
+{
+    for(byte i = 0; i < 26; i++)
+        axisForLetter[i] = -1;
+    for(byte i = 0; i < GCODE_MAX_AXES; i++)
+    {
+        mappers[i] = nullptr;
+        homePosition[i] = 0;
+        position[i] = 0;
+    }
+}
+
+bool GcodeParser::setAxis(byte axis, char letter, const FloatMapper *mmToSteps, float homeMm)
+{
+    if(axis >= GCODE_MAX_AXES || mmToSteps == nullptr)
+        return false;
+    if(letter >= 'a' && letter <= 'z')
+        letter -= 'a' - 'A';
+    // F, G, M, N and S mean something already
+    if(letter < 'A' || letter > 'Z' || letter == 'F' || letter == 'G' || letter == 'M' || letter == 'N' || letter == 'S')
+        return false;
+    axisForLetter[letter - 'A'] = axis;
+    mappers[axis] = mmToSteps;
+    homePosition[axis] = homeMm;
+    position[axis] = homeMm;
+    if(axis >= axisCount)
+        axisCount = axis + 1;
+    return true;
+}
+
+bool GcodeParser::feed(char c)
+{
+    if(c == '\n' || c == '\r')
+    {
+        // A line can queue a move and an M-code, so don't start one without room for both
+        if(queue.size() + 2 > queue.capacity())
+            return false;
+        processLine();
+        length = 0;
+        overflow = false;
+        lineComment = false;
+        parenComment = false;
+        return true;
+    }
+    if(lineComment)
+        return true;
+    if(parenComment)
+    {
+        parenComment = c != ')';
+        return true;
+    }
+    if(c == ';')
+        lineComment = true;
+    else if(c == '(')
+        parenComment = true;
+    else if(c != ' ' && c != '\t')
+    {
+        if(length < GCODE_LINE_LENGTH - 1)
+            line[length++] = (c >= 'a' && c <= 'z') ? c - ('a' - 'A') : c;
+        else
+            overflow = true;
+    }
+    return true;
+}
+
+size_t GcodeParser::poll(Stream &stream)
+{
+    size_t taken = 0;
+    // Stop before a byte that can't be taken, read() can't give it back
+    while(queue.size() + 2 <= queue.capacity() && stream.available() > 0)
+    {
+        int c = stream.read();
+        if(c < 0)
+            break;
+        feed((char)c);
+        taken++;
+    }
+    return taken;
+}
+
+// Plain decimal, [+-]digits[.digits]. Faster than strtof and all G-code ever sends.
+bool GcodeParser::parseNumber(const char *&cursor, float *value)
+{
+    bool negative = false;
+    if(*cursor == '-' || *cursor == '+')
+        negative = *cursor++ == '-';
+    long whole = 0;
+    long fraction = 0;
+    long scale = 1;
+    bool digits = false;
+    while(*cursor >= '0' && *cursor <= '9')
+    {
+        whole = whole * 10 + (*cursor++ - '0');
+        digits = true;
+    }
+    if(*cursor == '.')
+    {
+        cursor++;
+        while(*cursor >= '0' && *cursor <= '9')
+        {
+            // Past 6 places a float can't tell the difference anyway
+            if(scale < 1000000)
+            {
+                fraction = fraction * 10 + (*cursor - '0');
+                scale *= 10;
+            }
+            cursor++;
+            digits = true;
+        }
+    }
+    float result = whole + (float)fraction / scale;
+    *value = negative ? -result : result;
+    return digits;
+}
+
+void GcodeParser::processLine()
+{
+    if(overflow)
+    {
+        errorCount++;
+        return;
+    }
+    if(length == 0)
+        return;
+    line[length] = 0;
+    lineCount++;
+
+    float axisValues[GCODE_MAX_AXES];
+    byte axisWords = 0;
+    bool home = false;
+    bool hasM = false;
+    int mCode = 0;
+    float sValue = 0;
+    // Modal state only changes once the whole line has parsed, a bad word drops all of it
+    bool lineRapid = rapid;
+    bool lineAbsolute = absolute;
+    float lineFeed = feedRate;
+
+    const char *cursor = line;
+    while(*cursor)
+    {
+        char letter = *cursor++;
+        float value;
+        if(letter < 'A' || letter > 'Z' || !parseNumber(cursor, &value))
+        {
+            errorCount++;
+            return;
+        }
+        switch(letter)
+        {
+            case 'G':
+                switch((int)value)
+                {
+                    case 0: lineRapid = true; break;
+                    case 1: lineRapid = false; break;
+                    case 28: home = true; break;
+                    case 90: lineAbsolute = true; break;
+                    case 91: lineAbsolute = false; break;
+                    default: errorCount++; return;
+                }
+                break;
+            case 'M':
+                hasM = true;
+                mCode = (int)value;
+                break;
+            case 'F':
+                if(value > 0)
+                    lineFeed = value;
+                break;
+            case 'S':
+                sValue = value;
+                break;
+            case 'N':
+                break;
+            default:
+            {
+                int8_t axis = axisForLetter[letter - 'A'];
+                if(axis < 0)
+                {
+                    errorCount++;
+                    return;
+                }
+                axisValues[axis] = value;
+                axisWords |= 1 << axis;
+            }
+        }
+        // Checksum, the link layer's problem not ours
+        if(*cursor == '*')
+            break;
+    }
+
+    rapid = lineRapid;
+    absolute = lineAbsolute;
+    feedRate = lineFeed;
+
+    GcodeCommand command;
+    if(home)
+    {
+        // G28 on its own homes everything, with axis words just those. Axes that don't home
+        // stay where they are.
+        command.type = GCODE_HOME;
+        command.axisMask = axisWords != 0 ? axisWords : (byte)((1 << axisCount) - 1);
+        for(byte i = 0; i < axisCount; i++)
+        {
+            if(command.axisMask & homingAxes & (1 << i))
+                position[i] = homePosition[i];
+        }
+        queue.push(command);
+    }
+    else if(axisWords != 0)
+    {
+        float target[GCODE_MAX_AXES];
+        for(byte i = 0; i < axisCount; i++)
+        {
+            if(axisWords & (1 << i))
+                target[i] = absolute ? axisValues[i] : position[i] + axisValues[i];
+            else
+                target[i] = position[i];
+        }
+        queueMove(target, rapid ? rapidFeed : feedRate);
+    }
+
+    if(hasM)
+    {
+        command.type = GCODE_MCODE;
+        command.code = mCode;
+        command.value = sValue;
+        queue.push(command);
+    }
+}
+
+void GcodeParser::queueMove(const float *target, float mmPerMinute)
+{
+    GcodeCommand command;
+    command.type = GCODE_MOVE;
+    command.axisMask = 0;
+    float mmSquared = 0;
+    float stepsSquared = 0;
+    for(byte i = 0; i < GCODE_MAX_AXES; i++)
+    {
+        // No mapper, no idea where it is. Left out of axisMask so the executor holds it where it is.
+        if(i >= axisCount || mappers[i] == nullptr)
+        {
+            command.target[i] = 0;
+            continue;
+        }
+        command.axisMask |= 1 << i;
+        float from = mappers[i]->map(position[i]);
+        float to = mappers[i]->map(target[i]);
+        command.target[i] = lroundf(to);
+        mmSquared += (target[i] - position[i]) * (target[i] - position[i]);
+        stepsSquared += (to - from) * (to - from);
+        position[i] = target[i];
+    }
+    if(mmSquared == 0)
+        return;
+    // Feed is along the path in mm, the planner wants path steps
+    command.speed = mmPerMinute / 60.0f * sqrtf(stepsSquared / mmSquared);
+    queue.push(command);
+}
@@ -0,0 +1,89 @@
+//
+// Created by Andrew Simmons on 10/15/26.
+//
+
+#ifndef FIRMWORK_GCODEPARSER_H
+#define FIRMWORK_GCODEPARSER_H
+#include <Arduino.h>
+#include "Mapper.h"
+#include "SpscQueue.h"
+
+#define GCODE_MAX_AXES 4
+#define GCODE_LINE_LENGTH 96
+#define GCODE_QUEUE_SIZE 16
+#define GCODE_DEFAULT_FEED 600.0f   // mm/min until the first F
+#define GCODE_DEFAULT_RAPID 3000.0f // mm/min for G0
+
+typedef enum GcodeCommandType
+{
+    GCODE_MOVE,  // target (absolute steps), speed (path steps/s), axisMask (the axes target covers)
+    GCODE_HOME,  // axisMask
+    GCODE_MCODE, // code, value (S word, 0 if none)
+} GcodeCommandType;
+
+typedef struct GcodeCommand
+{
+    GcodeCommandType type;
+    long target[GCODE_MAX_AXES];
+    float speed;
+    byte axisMask;
+    int code;
+    float value;
+} GcodeCommand;
+
+// Streaming parser for the G-code subset our plotters get sent: G0/G1 (modal), G28, G90/G91, F and
+// M-codes. Bytes go in one at a time from anything, finished lines come out as commands in step
+// units on a bounded queue, through each axis' mm -> steps mapper. No allocation, the line buffer
+// and the queue are fixed. When the queue's full the parser stops taking bytes, so the backpressure
+// ends up in the serial buffer/flow control instead of dropped lines.
+// The queue is an SpscQueue, so parsing and pop() can be on different tasks.
+class GcodeParser
+{
+    public:
+        GcodeParser();
+        // letter is the word that drives the axis (X, Y, ...), mapper is mm -> steps and has to
+        // outlive the parser. homeMm is where G28 leaves it.
+        bool setAxis(byte axis, char letter, const FloatMapper *mmToSteps, float homeMm = 0);
+        // Which axes G28 really moves, all of them unless told otherwise. The rest keep their position.
+        void setHomingAxes(byte axisMask) {homingAxes = axisMask;}
+        void setRapidFeed(float mmPerMinute) {rapidFeed = mmPerMinute;}
+        void setFeedRate(float mmPerMinute) {feedRate = mmPerMinute;}
+
+        // False means c wasn't taken (end of a line with the queue full), offer it again later
+        bool feed(char c);
+        // Reads until the stream's empty or the queue's full, returns bytes taken
+        size_t poll(Stream &stream);
+        bool pop(GcodeCommand &command) {return queue.pop(command);}
+        uint32_t getQueued() const {return queue.size();}
+
+        bool isAbsolute() const {return absolute;}
+        float getPosition(byte axis) const {return axis < GCODE_MAX_AXES ? position[axis] : 0;}
+        unsigned long getLineCount() const {return lineCount;}
+        // Lines too long, words without a number, codes outside the subset. The line is dropped.
+        unsigned long getErrorCount() const {return errorCount;}
+    private:
+        SpscQueue<GcodeCommand, GCODE_QUEUE_SIZE> queue;
+        char line[GCODE_LINE_LENGTH];
+        byte length = 0;
+        bool overflow = false;
+        bool lineComment = false;
+        bool parenComment = false;
+        const FloatMapper *mappers[GCODE_MAX_AXES];
+        int8_t axisForLetter[26];
+        float homePosition[GCODE_MAX_AXES];
+        float position[GCODE_MAX_AXES];
+        byte axisCount = 0;
+        byte homingAxes = 0xFF;
+        bool absolute = true;
+        bool rapid = false;
+        float feedRate = GCODE_DEFAULT_FEED;
+        float rapidFeed = GCODE_DEFAULT_RAPID;
+        unsigned long lineCount = 0;
+        unsigned long errorCount = 0;
+        void processLine();
+        void queueMove(const float *target, float mmPerMinute);
+        static bool parseNumber(const char *&cursor, float *value);
+};
+
+
+#endif //FIRMWORK_GCODEPARSER_H
@@ -0,0 +1,58 @@
+//
+// Created by Andrew Simmons on 10/15/26.
+//
+
+#ifndef FIRMWORK_INLINEFUNCTION_H
+#define FIRMWORK_INLINEFUNCTION_H
+#include <Arduino.h>
+#include <stddef.h>
+#include <new>
+#include <type_traits>
+
+template<typename Signature, size_t Capacity>
+class InlineFunction;
+
+// std::function without the heap: the callable (function pointer, lambda capturing this or a
+// context pointer, small functor) is copied into Capacity bytes inside the object. Too big, too
+// aligned, or not trivially copyable is a compile error, so copying one is just its bytes and
+// there's nothing to destroy.
+template<typename R, typename... Args, size_t Capacity>
+class InlineFunction<R(Args...), Capacity>
+{
+    public:
+        InlineFunction() = default;
+        InlineFunction(std::nullptr_t) {}
+        template<typename F, typename = typename std::enable_if<
+                !std::is_same<typename std::decay<F>::type, InlineFunction>::value>::type>
+        InlineFunction(F f)
+        {
+            static_assert(sizeof(F) <= Capacity, "InlineFunction: callable doesn't fit, capture less or raise Capacity");
+            static_assert(alignof(F) <= alignof(max_align_t), "InlineFunction: callable is over aligned");
+            static_assert(std::is_trivially_copyable<F>::value && std::is_trivially_destructible<F>::value,
+                          "InlineFunction: captures must be trivially copyable (pointers and plain values)");
+            new(storage) F(f);
+            invoker = &invoke<F>;
+        }
+
+        R operator()(Args... args) const {return invoker(storage, args...);}
+        explicit operator bool() const {return invoker != nullptr;}
+        bool operator==(std::nullptr_t) const {return invoker == nullptr;}
+        bool operator!=(std::nullptr_t) const {return invoker != nullptr;}
+        static constexpr size_t capacity() {return Capacity;}
+        // The stored callable if it's a T, nullptr otherwise, like std::function::target().
+        // target<R (*)(Args...)>() gets a plain function pointer back out.
+        template<typename T>
+        T *target() const {return invoker == &invoke<T> ? (T *)storage : nullptr;}
+    private:
+        template<typename F>
+        static R invoke(void *data, Args... args)
+        {
+            return (*(F *)data)(args...);
+        }
+        R (*invoker)(void *, Args...) = nullptr;
+        // mutable so a mutable lambda's state can change under a const call, like std::function
+        alignas(max_align_t) mutable unsigned char storage[Capacity] = {};
+};
+
+
+#endif //FIRMWORK_INLINEFUNCTION_H
@@ -0,0 +1,96 @@
+//
+// Created by Andrew Simmons on 10/15/26.
+//
+
+#include "LimitSwitch.h"
+#include "StepTimerBackend.h"
+
+LimitSwitch::LimitSwitch(uint8_t pin, uint8_t activeLevel, uint8_t inputMode) :
+        pin(pin), activeLevel(activeLevel), inputMode(inputMode)
+{
+
+}
+
+LimitSwitch::~LimitSwitch()
+{
+    end();
+}
+
+void LimitSwitch::begin()
+{
+    pinMode(pin, inputMode);
+    // Start out in whatever state it's really in, no debounce wait on boot
+    bool closed = digitalRead(pin) == activeLevel;
+    state.store(closed ? LIMIT_SWITCH_CLOSED : LIMIT_SWITCH_OPEN, std::memory_order_release);
+    if(closed)
+    {
+        latched.store(true, std::memory_order_release);
+        triggerCount.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void LimitSwitch::beginInterrupt()
+{
+    begin();
+    attachInterruptArg(digitalPinToInterrupt(pin), onInterrupt, this, CHANGE);
+    interruptAttached = true;
+}
+
+void LimitSwitch::end()
+{
+    if(!interruptAttached)
+        return;
+    detachInterrupt(digitalPinToInterrupt(pin));
+    interruptAttached = false;
+}
+
+void IRAM_ATTR LimitSwitch::onInterrupt(void *arg)
+{
+    LimitSwitch *limit = (LimitSwitch *)arg;
+    limit->onLevel(digitalRead(limit->pin) == limit->activeLevel);
+}
+
+void LimitSwitch::sample()
+{
+    onLevel(digitalRead(pin) == activeLevel);
+    if(state.load(std::memory_order_acquire) == LIMIT_SWITCH_RELEASING)
+        checkRelease();
+}
+
+void LimitSwitch::setTripBackend(StepTimerBackend *backend, bool highSide)
+{
+    // Side first, the pointer publishes it
+    tripBackend.store(nullptr, std::memory_order_release);
+    tripHighSide = highSide;
+    tripBackend.store(backend, std::memory_order_release);
+}
+
+// Closing takes effect now. Opening only starts the debounce clock, any bounce back closed
+// cancels it and the next open starts it over.
+void IRAM_ATTR LimitSwitch::onLevel(bool closed)
+{
+    if(closed)
+    {
+        latched.store(true, std::memory_order_release);
+        StepTimerBackend *backend = tripBackend.load(std::memory_order_acquire);
+        if(backend != nullptr)
+            backend->requestLimitAbort(tripHighSide);
+        if(state.exchange(LIMIT_SWITCH_CLOSED, std::memory_order_acq_rel) == LIMIT_SWITCH_OPEN)
+            triggerCount.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    if(state.load(std::memory_order_relaxed) != LIMIT_SWITCH_CLOSED)
+        return;
+    releaseMicros.store(micros(), std::memory_order_relaxed);
+    int expected = LIMIT_SWITCH_CLOSED;
+    state.compare_exchange_strong(expected, LIMIT_SWITCH_RELEASING, std::memory_order_acq_rel);
+}
+
+// True once it's really open. If it closed again in the meantime the exchange fails and it stays put.
+bool LimitSwitch::checkRelease()
+{
+    if((uint32_t)((uint32_t)micros() - releaseMicros.load(std::memory_order_relaxed)) < debounceMicros)
+        return false;
+    int expected = LIMIT_SWITCH_RELEASING;
+    return state.compare_exchange_strong(expected, LIMIT_SWITCH_OPEN, std::memory_order_acq_rel);
+}
@@ -0,0 +1,82 @@
+//
+// Created by Andrew Simmons on 10/15/26.
+//
+
+#ifndef FIRMWORK_LIMITSWITCH_H
+#define FIRMWORK_LIMITSWITCH_H
+#include <Arduino.h>
+#include <atomic>
+
+#define LIMIT_SWITCH_DEFAULT_DEBOUNCE_MICROS 2000
+
+class StepTimerBackend;
+
+typedef enum LimitSwitchState
+{
+    LIMIT_SWITCH_OPEN,
+    LIMIT_SWITCH_CLOSED,
+    LIMIT_SWITCH_RELEASING, // read open, still counts as closed until the debounce time is up
+} LimitSwitchState;
+
+// A limit switch whose state is kept in a flag, so checking it is one load instead of a
+// digitalRead. The flag is set the moment the switch closes (no waiting out bounce, a limit
+// should act straight away) and only clears once it's read open for the whole debounce time.
+// Either an interrupt keeps it up to date (beginInterrupt) or something calls sample() often,
+// e.g. from a Timer (begin). Closing is also latched, so a short hit between two polls isn't lost.
+class LimitSwitch
+{
+    public:
+        explicit LimitSwitch(uint8_t pin, uint8_t activeLevel = LOW, uint8_t inputMode = INPUT_PULLUP);
+        ~LimitSwitch();
+        // Sampled, call sample() yourself
+        void begin();
+        // Pin change interrupt does the work
+        void beginInterrupt();
+        void end();
+        void setDebounceMicros(unsigned long micros) {debounceMicros = micros;}
+        void sample();
+
+        // Cheap while open, only a pending release has to look at the time
+        bool isActive()
+        {
+            int current = state.load(std::memory_order_acquire);
+            if(current == LIMIT_SWITCH_OPEN)
+                return false;
+            return current == LIMIT_SWITCH_CLOSED || !checkRelease();
+        }
+        // For ISRs: closed, releasing or latched. No clock read, a release still in its debounce
+        // time counts as closed.
+        bool isTripped() const
+        {
+            return latched.load(std::memory_order_acquire) ||
+                   state.load(std::memory_order_acquire) != LIMIT_SWITCH_OPEN;
+        }
+        // Closed at some point since the last clearLatch()
+        bool wasTriggered() const {return latched.load(std::memory_order_acquire);}
+        void clearLatch() {latched.store(false, std::memory_order_release);}
+        unsigned long getTriggerCount() const {return triggerCount.load(std::memory_order_relaxed);}
+        // Closing also tells this backend's ISR to drop its move if it's stepping toward us
+        // (highSide: we're the forward limit). StepTimerBackend::setLimitSwitches() does it.
+        void setTripBackend(StepTimerBackend *backend, bool highSide);
+        StepTimerBackend *getTripBackend() const {return tripBackend.load(std::memory_order_acquire);}
+        uint8_t getPin() const {return pin;}
+    private:
+        uint8_t pin;
+        uint8_t activeLevel;
+        uint8_t inputMode;
+        unsigned long debounceMicros = LIMIT_SWITCH_DEFAULT_DEBOUNCE_MICROS;
+        bool interruptAttached = false;
+        // Only ever moved with exchange/compare_exchange, the ISR and the poller both change it
+        std::atomic<int> state{LIMIT_SWITCH_OPEN};
+        std::atomic<bool> latched{false};
+        std::atomic<uint32_t> releaseMicros{0};
+        std::atomic<unsigned long> triggerCount{0};
+        std::atomic<StepTimerBackend *> tripBackend{nullptr};
+        bool tripHighSide = false;
+        void IRAM_ATTR onLevel(bool closed);
+        bool checkRelease();
+        static void IRAM_ATTR onInterrupt(void *arg);
+};
+
+
+#endif //FIRMWORK_LIMITSWITCH_H
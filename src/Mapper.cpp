@@ -0,0 +1,177 @@
+//
+// Created by Andrew Simmons on 10/15/26.
+//
+
+#include "Mapper.h"
+#if defined(FIRMWORK_USE_ESP_DSP)
+#include <esp_dsp.h>
+#endif
+
+FloatMapper::FloatMapper(FloatRange in, FloatRange out, bool clamp) : in(in), out(out), clamp(clamp)
+{
+    float inSpan = in.max - in.min;
+    float outSpan = out.max - out.min;
+    // A zero width range just pins everything to the other range's min
+    slope = inSpan != 0 ? outSpan / inSpan : 0;
+    offset = out.min - in.min * slope;
+    inverseSlope = outSpan != 0 ? inSpan / outSpan : 0;
+    inverseOffset = in.min - out.min * inverseSlope;
+
+    inLow = in.min < in.max ? in.min : in.max;
+    inHigh = in.min < in.max ? in.max : in.min;
+    outLow = out.min < out.max ? out.min : out.max;
+    outHigh = out.min < out.max ? out.max : out.min;
+}
+
+FloatMapper FloatMapper::inverted() const
+{
+    return FloatMapper(out, in, clamp);
+}
+
+static inline float clampFloat(float y, float low, float high)
+{
+    return y < low ? low : (y > high ? high : y);
+}
+
+// Work in blocks of 4 (a 16 byte vector, same as the S3's PIE registers): all 4 loads happen
+// before any store, so in == out is fine and the compiler can turn each block into vector ops
+// at -O2 without alias checks. Leftovers go one at a time.
+template<typename In, typename Map>
+static inline void mapBlocks(const In *input, float *output, size_t count, Map map)
+{
+    size_t i = 0;
+    for(; i + 4 <= count; i += 4)
+    {
+        float x0 = input[i], x1 = input[i + 1], x2 = input[i + 2], x3 = input[i + 3];
+        float y0 = map(x0), y1 = map(x1), y2 = map(x2), y3 = map(x3);
+        output[i] = y0; output[i + 1] = y1; output[i + 2] = y2; output[i + 3] = y3;
+    }
+    for(; i < count; i++)
+        output[i] = map((float)input[i]);
+}
+
+void FloatMapper::mapArray(const float *input, float *output, size_t count) const
+{
+#if defined(FIRMWORK_USE_ESP_DSP)
+    if(!clamp)
+    {
+        dsps_mulc_f32(input, output, count, slope, 1, 1);
+        dsps_addc_f32(output, output, count, offset, 1, 1);
+        return;
+    }
+#endif
+    // Locals so the compiler knows the stores can't change them
+    const float m = slope, b = offset, low = outLow, high = outHigh;
+    if(clamp)
+        mapBlocks(input, output, count, [=](float x) {return clampFloat(x * m + b, low, high);});
+    else
+        mapBlocks(input, output, count, [=](float x) {return x * m + b;});
+}
+
+void FloatMapper::mapArray(const int16_t *input, float *output, size_t count) const
+{
+    const float m = slope, b = offset, low = outLow, high = outHigh;
+    if(clamp)
+        mapBlocks(input, output, count, [=](float x) {return clampFloat(x * m + b, low, high);});
+    else
+        mapBlocks(input, output, count, [=](float x) {return x * m + b;});
+}
+
+LongMapper::LongMapper(LRange in, LRange out, bool clamp) : in(in), out(out), clamp(clamp)
+{
+    forward = makeStep(in, out);
+    backward = makeStep(out, in);
+    float inSpan = (float)in.max - in.min;
+    floatSlope = inSpan != 0 ? ((float)out.max - out.min) / inSpan : 0;
+    floatOffset = out.min - in.min * floatSlope;
+    inLow = in.min < in.max ? in.min : in.max;
+    inHigh = in.min < in.max ? in.max : in.min;
+    outLow = out.min < out.max ? out.min : out.max;
+    outHigh = out.min < out.max ? out.max : out.min;
+}
+
+LongMapper LongMapper::inverted() const
+{
+    return LongMapper(out, in, clamp);
+}
+
+LongMapStep LongMapper::makeStep(LRange from, LRange to)
+{
+    LongMapStep step;
+    step.inMin = from.min;
+    step.outMin = to.min;
+    step.shift = 0;
+    step.slope = 0;
+
+    long long fromSpan = (long long)from.max - from.min;
+    long long toSpan = (long long)to.max - to.min;
+    if(fromSpan == 0)
+        return step;
+
+    unsigned long long fromAbs = fromSpan < 0 ? -fromSpan : fromSpan;
+    unsigned long long toAbs = toSpan < 0 ? -toSpan : toSpan;
+    // Biggest shift where the scaled slope stays under 2^31 and a full span times it under 2^62
+    while(step.shift < 32 && (toAbs << (step.shift + 1)) < (1ULL << 62) &&
+          ((toAbs << (step.shift + 1)) / fromAbs) < (1ULL << 31))
+        step.shift++;
+
+    long long scaled = (long long)(toAbs << step.shift);
+    long long slope = (scaled + (long long)(fromAbs / 2)) / (long long)fromAbs;
+    step.slope = (fromSpan < 0) != (toSpan < 0) ? -slope : slope;
+    return step;
+}
+
+void LongMapper::mapArray(const int32_t *input, int32_t *output, size_t count) const
+{
+    const long low = inLow, high = inHigh;
+    const bool clampIn = clamp;
+    for(size_t i = 0; i < count; i++)
+    {
+        long x = input[i];
+        if(clampIn)
+            x = x < low ? low : (x > high ? high : x);
+        output[i] = apply(forward, x);
+    }
+}
+
+// y already clamped to int16, so y + 32768.5 is always positive and truncating it is
+// floor(y + 0.5) without floorf(), which won't vectorize without SSE4.1
+static inline int16_t roundInt16(float y)
+{
+    return (int16_t)((int32_t)(y + 32768.5f) - 32768);
+}
+
+// 16 bit values fit a float's mantissa with room to spare, so a float multiply-add lands within
+// the same 1 count as map() and vectorizes, where the 64 bit fixed point path won't
+void LongMapper::mapArray(const int16_t *input, int16_t *output, size_t count) const
+{
+    const float m = floatSlope, b = floatOffset;
+    const float low = clamp ? outLow : -32768.0f, high = clamp ? outHigh : 32767.0f;
+    auto map = [=](float x) {return clampFloat(x * m + b, low, high);};
+    size_t i = 0;
+    for(; i + 4 <= count; i += 4)
+    {
+        float x0 = input[i], x1 = input[i + 1], x2 = input[i + 2], x3 = input[i + 3];
+        float y0 = map(x0), y1 = map(x1), y2 = map(x2), y3 = map(x3);
+        output[i] = roundInt16(y0); output[i + 1] = roundInt16(y1); output[i + 2] = roundInt16(y2); output[i + 3] = roundInt16(y3);
+    }
+    for(; i < count; i++)
+        output[i] = roundInt16(map((float)input[i]));
+}
+
+IntMapper::IntMapper(LRange in, LRange out, MapRounding rounding, bool saturate) :
+        in(in), out(out), rounding(rounding), inMin(in.min), outMin(out.min)
+{
+    int64_t inDiff = (int64_t)in.max - in.min;
+    int64_t outDiff = (int64_t)out.max - out.min;
+    negativeSlope = (inDiff < 0) != (outDiff < 0);
+    // A zero width in range maps everything to out.min, like IntMap
+    inSpan = inDiff != 0 ? (uint64_t)(inDiff < 0 ? -inDiff : inDiff) : 1;
+    outSpan = inDiff != 0 ? (uint64_t)(outDiff < 0 ? -outDiff : outDiff) : 0;
+    reciprocal = UINT64_MAX / inSpan;
+
+    int32_t outLow = out.min < out.max ? out.min : out.max;
+    int32_t outHigh = out.min < out.max ? out.max : out.min;
+    low = saturate ? outLow : INT32_MIN;
+    high = saturate ? outHigh : INT32_MAX;
+}
@@ -0,0 +1,151 @@
+//
+// Created by Andrew Simmons on 10/15/26.
+//
+
+#ifndef FIRMWORK_MAPPER_H
+#define FIRMWORK_MAPPER_H
+#include <Arduino.h>
+#include "MathHelper.h"
+
+// Same result as MathHelper::FRangeMap, but the slope/offset get worked out once up front
+// so each map() is a single multiply-add instead of a divide.
+class FloatMapper
+{
+    public:
+        FloatMapper(FloatRange in, FloatRange out, bool clamp = false);
+        float map(float x) const
+        {
+            float y = x * slope + offset;
+            if(clamp)
+                y = y < outLow ? outLow : (y > outHigh ? outHigh : y);
+            return y;
+        }
+        float inverse(float y) const
+        {
+            float x = y * inverseSlope + inverseOffset;
+            if(clamp)
+                x = x < inLow ? inLow : (x > inHigh ? inHigh : x);
+            return x;
+        }
+        FloatMapper inverted() const;
+        // Whole buffers at once, in and out can be the same buffer. Plain loops the compiler
+        // vectorizes, or esp-dsp's mulc/addc with FIRMWORK_USE_ESP_DSP (unclamped float only).
+        // Keep buffers 16 byte aligned and sized in multiples of 4 for the S3's PIE.
+        void mapArray(const float *input, float *output, size_t count) const;
+        void mapArray(const int16_t *input, float *output, size_t count) const;
+        FloatRange getIn() const {return in;}
+        FloatRange getOut() const {return out;}
+    private:
+        FloatRange in, out;
+        bool clamp;
+        float slope, offset, inverseSlope, inverseOffset;
+        float inLow, inHigh, outLow, outHigh;
+};
+
+// Fixed point params for one direction of a LongMapper
+typedef struct LongMapStep
+{
+    long long slope;  // out span / in span, scaled by 2^shift
+    long inMin, outMin;
+    byte shift;
+} LongMapStep;
+
+// Integer version, no float at all. The slope keeps ~31 significant bits (shift is picked to fit),
+// results are within 1 of exact rounding. In range inputs can't overflow, out of range ones extrapolate
+// unless clamp is on.
+class LongMapper
+{
+    public:
+        LongMapper(LRange in, LRange out, bool clamp = false);
+        long map(long x) const
+        {
+            if(clamp)
+                x = x < inLow ? inLow : (x > inHigh ? inHigh : x);
+            return apply(forward, x);
+        }
+        long inverse(long y) const
+        {
+            if(clamp)
+                y = y < outLow ? outLow : (y > outHigh ? outHigh : y);
+            return apply(backward, y);
+        }
+        LongMapper inverted() const;
+        // Within the same 1 count as map() per element, int16 output saturates
+        void mapArray(const int32_t *input, int32_t *output, size_t count) const;
+        void mapArray(const int16_t *input, int16_t *output, size_t count) const;
+        LRange getIn() const {return in;}
+        LRange getOut() const {return out;}
+    private:
+        LRange in, out;
+        bool clamp;
+        long inLow, inHigh, outLow, outHigh;
+        LongMapStep forward, backward;
+        float floatSlope, floatOffset; // only for the int16 batch path
+        static LongMapStep makeStep(LRange from, LRange to);
+        static long apply(const LongMapStep &step, long x)
+        {
+            long long half = step.shift > 0 ? (1LL << (step.shift - 1)) : 0;
+            return step.outMin + (long)(((x - (long long)step.inMin) * step.slope + half) >> step.shift);
+        }
+};
+
+// MathHelper::IntMap with the divide taken out: the in span's reciprocal is worked out once, and
+// each map() gets the exact quotient and remainder from a 64 bit multiply-high plus at most two
+// corrections, so rounding and saturation match IntMap bit for bit.
+class IntMapper
+{
+    public:
+        IntMapper(LRange in, LRange out, MapRounding rounding = MAP_ROUND_NEAREST, bool saturate = false);
+        int32_t map(int32_t x) const
+        {
+            int64_t a = (int64_t)x - inMin;
+            bool negative = (a < 0) != negativeSlope;
+            uint64_t product = (uint64_t)(a < 0 ? -a : a) * outSpan;
+            uint64_t quotient = mulHigh(product, reciprocal);
+            uint64_t remainder = product - quotient * inSpan;
+            while(remainder >= inSpan)
+            {
+                quotient++;
+                remainder -= inSpan;
+            }
+            if(remainder != 0)
+            {
+                if(rounding == MAP_ROUND_NEAREST)
+                    quotient += (remainder * 2 >= inSpan) ? 1 : 0;
+                else if((rounding == MAP_ROUND_CEIL && !negative) || (rounding == MAP_ROUND_FLOOR && negative))
+                    quotient++;
+            }
+            // Only a 1 wide in span can get here, pinned like MulDiv
+            if(quotient > (uint64_t)INT64_MAX)
+                quotient = INT64_MAX;
+            int64_t result = (int64_t)outMin + (negative ? -(int64_t)quotient : (int64_t)quotient);
+            return (int32_t)(result < low ? low : (result > high ? high : result));
+        }
+        LRange getIn() const {return in;}
+        LRange getOut() const {return out;}
+    private:
+        LRange in, out;
+        MapRounding rounding;
+        int32_t inMin, outMin;
+        uint64_t inSpan, outSpan, reciprocal; // reciprocal = (2^64 - 1) / inSpan
+        bool negativeSlope;
+        int64_t low, high;
+        // Top 64 bits of a 128 bit product. The ESP32 has no __int128, so there it's 32 bit halves.
+        static uint64_t mulHigh(uint64_t a, uint64_t b)
+        {
+#if defined(__SIZEOF_INT128__)
+            return (uint64_t)(((unsigned __int128)a * b) >> 64);
+#else
+            uint64_t aLow = (uint32_t)a, aHigh = a >> 32;
+            uint64_t bLow = (uint32_t)b, bHigh = b >> 32;
+            uint64_t lowLow = aLow * bLow;
+            uint64_t highLow = aHigh * bLow;
+            uint64_t lowHigh = aLow * bHigh;
+            uint64_t middle = (lowLow >> 32) + (uint32_t)highLow + (uint32_t)lowHigh;
+            return aHigh * bHigh + (highLow >> 32) + (lowHigh >> 32) + (middle >> 32);
+#endif
+        }
+};
+
+
+#endif //FIRMWORK_MAPPER_H
@@ -4,13 +4,14 @@
 
 #include <Arduino.h>
 #include "MathHelper.h"
+#include "Mapper.h"
 
 double MathHelper::map(double x, double in_min, double in_max, double out_min, double out_max)
 {
     return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
 }
 
-long MathHelper::LLongMap(long long x, long long in_min, long long in_max, long long out_min, long long out_max) {
+long long MathHelper::LLongMap(long long x, long long in_min, long long in_max, long long out_min, long long out_max) {
     return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
 }
 
@@ -34,3 +35,87 @@ float MathHelper::FRangeMap(float x, FloatRange inRange, FloatRange outRange) {
     return FloatMap(x, inRange.min, inRange.max, outRange.min, outRange.max);
 }
 
+void MathHelper::FRangeMapArray(const float *input, float *output, size_t count, FloatRange inRange, FloatRange outRange)
+{
+    FloatMapper(inRange, outRange).mapArray(input, output, count);
+}
+
+void MathHelper::FRangeMapArray(const int16_t *input, float *output, size_t count, FloatRange inRange, FloatRange outRange)
+{
+    FloatMapper(inRange, outRange).mapArray(input, output, count);
+}
+
+void MathHelper::LRangeMapArray(const int32_t *input, int32_t *output, size_t count, LRange inRange, LRange outRange)
+{
+    LongMapper(inRange, outRange).mapArray(input, output, count);
+}
+
+void MathHelper::LRangeMapArray(const int16_t *input, int16_t *output, size_t count, LRange inRange, LRange outRange)
+{
+    LongMapper(inRange, outRange).mapArray(input, output, count);
+}
+
+// a * b / c with |a|, |b| < 2^32 so the unsigned product always fits in 64 bits.
+// Quotients too big for int64 come back pinned, the callers clamp to 32 bits anyway.
+int64_t MathHelper::MulDiv(int64_t a, int64_t b, int64_t c, MapRounding rounding)
+{
+    bool negative = ((a < 0) != (b < 0)) != (c < 0);
+    uint64_t ua = a < 0 ? -a : a;
+    uint64_t ub = b < 0 ? -b : b;
+    uint64_t uc = c < 0 ? -c : c;
+    uint64_t product = ua * ub;
+    uint64_t quotient = product / uc;
+    uint64_t remainder = product % uc;
+
+    if(remainder != 0)
+    {
+        if(rounding == MAP_ROUND_NEAREST)
+            quotient += (remainder * 2 >= uc) ? 1 : 0;
+        else if((rounding == MAP_ROUND_CEIL && !negative) || (rounding == MAP_ROUND_FLOOR && negative))
+            quotient++;
+    }
+
+    if(quotient > (uint64_t)INT64_MAX)
+        quotient = INT64_MAX;
+    return negative ? -(int64_t)quotient : (int64_t)quotient;
+}
+
+int32_t MathHelper::RoundShift(int32_t q, byte bits, MapRounding rounding)
+{
+    return (int32_t)MulDiv(q, 1, 1L << bits, rounding);
+}
+
+int32_t MathHelper::IntMap(int32_t x, int32_t in_min, int32_t in_max, int32_t out_min, int32_t out_max,
+                           MapRounding rounding, bool saturate)
+{
+    int32_t outLow = out_min < out_max ? out_min : out_max;
+    int32_t outHigh = out_min < out_max ? out_max : out_min;
+    if(in_max == in_min)
+        return out_min;
+
+    int64_t result = (int64_t)out_min + MulDiv((int64_t)x - in_min, (int64_t)out_max - out_min,
+                                               (int64_t)in_max - in_min, rounding);
+    int64_t low = saturate ? outLow : INT32_MIN;
+    int64_t high = saturate ? outHigh : INT32_MAX;
+    return (int32_t)(result < low ? low : (result > high ? high : result));
+}
+
+int32_t MathHelper::IntRangeMap(int32_t x, LRange inRange, LRange outRange, MapRounding rounding, bool saturate)
+{
+    return IntMap(x, inRange.min, inRange.max, outRange.min, outRange.max, rounding, saturate);
+}
+
+uint32_t MathHelper::UIntMap(uint32_t x, uint32_t in_min, uint32_t in_max, uint32_t out_min, uint32_t out_max,
+                             MapRounding rounding, bool saturate)
+{
+    uint32_t outLow = out_min < out_max ? out_min : out_max;
+    uint32_t outHigh = out_min < out_max ? out_max : out_min;
+    if(in_max == in_min)
+        return out_min;
+
+    int64_t result = (int64_t)out_min + MulDiv((int64_t)x - in_min, (int64_t)out_max - out_min,
+                                               (int64_t)in_max - in_min, rounding);
+    int64_t low = saturate ? outLow : 0;
+    int64_t high = saturate ? outHigh : UINT32_MAX;
+    return (uint32_t)(result < low ? low : (result > high ? high : result));
+}
@@ -4,6 +4,7 @@
 
 #ifndef ROBOTOPO_MATHHELPER_H
 #define ROBOTOPO_MATHHELPER_H
+#include <Arduino.h>
 
 
 typedef struct PixelPoint { byte x,y;} PixelPoint;
@@ -12,16 +13,58 @@ typedef struct ULLongRange { unsigned long long min, max; } ULongRange;
 typedef struct FloatRange { float min, max; } FloatRange;
 typedef struct LRange{ long min, max; } LRange;
 
+typedef enum MapRounding
+{
+    MAP_ROUND_TRUNCATE, // toward zero, same as LongMap (rounding is on the scaled offset from out_min)
+    MAP_ROUND_FLOOR,
+    MAP_ROUND_CEIL,
+    MAP_ROUND_NEAREST,  // halves away from zero
+} MapRounding;
+
+// Fixed point, raw int32 underneath. IntMap doesn't care about the scale, the in side and the
+// out side can each be plain ints or any Q format (steps in, Q16.16 mm out is fine).
+typedef int32_t Q16_16;
+typedef int32_t Q24_8;
+#define Q16_16_ONE 65536L
+#define Q24_8_ONE 256L
+
 class MathHelper
 {
     public:
         static double map(double x, double in_min, double in_max, double out_min, double out_max);
-        long LLongMap(long long int x, long long int in_min, long long int in_max, long long int out_min, long long int out_max);
+        long long LLongMap(long long int x, long long int in_min, long long int in_max, long long int out_min, long long int out_max);
         unsigned long ULongMap(unsigned long x, unsigned long in_min, unsigned long in_max, unsigned long out_min, unsigned long out_max);
         long LongMap(long x, long in_min, long in_max, long out_min, long out_max);
         long LRangeMap(long x, LRange inRange, LRange outRange);
         float FRangeMap(float x, FloatRange inRange, FloatRange outRange);
         float FloatMap(float x, float in_min, float in_max, float out_min, float out_max);
+        // Whole buffers, in and out can be the same buffer. See FloatMapper/LongMapper::mapArray.
+        static void FRangeMapArray(const float *input, float *output, size_t count, FloatRange inRange, FloatRange outRange);
+        static void FRangeMapArray(const int16_t *input, float *output, size_t count, FloatRange inRange, FloatRange outRange);
+        static void LRangeMapArray(const int32_t *input, int32_t *output, size_t count, LRange inRange, LRange outRange);
+        static void LRangeMapArray(const int16_t *input, int16_t *output, size_t count, LRange inRange, LRange outRange);
+
+        // Integer maps that can't overflow: the product is done unsigned in 64 bits, which any
+        // 32 bit inputs fit, then rounded. saturate clamps to the out range, otherwise results
+        // still clamp to int32/uint32 instead of wrapping. Each call is a 64 bit divide, so for
+        // the same ranges over and over use an IntMapper (Mapper.h), same results without it.
+        // These are for exact results, not speed: on the native host FloatMap still beats both.
+        static int32_t IntMap(int32_t x, int32_t in_min, int32_t in_max, int32_t out_min, int32_t out_max,
+                              MapRounding rounding = MAP_ROUND_NEAREST, bool saturate = false);
+        static int32_t IntRangeMap(int32_t x, LRange inRange, LRange outRange,
+                                   MapRounding rounding = MAP_ROUND_NEAREST, bool saturate = false);
+        // x below in_min maps below out_min (clamped at 0) instead of underflowing like ULongMap
+        static uint32_t UIntMap(uint32_t x, uint32_t in_min, uint32_t in_max, uint32_t out_min, uint32_t out_max,
+                                MapRounding rounding = MAP_ROUND_NEAREST, bool saturate = false);
+        static Q16_16 ToQ16_16(float f) {return (Q16_16)lroundf(f * Q16_16_ONE);}
+        static Q24_8 ToQ24_8(float f) {return (Q24_8)lroundf(f * Q24_8_ONE);}
+        static float FromQ16_16(Q16_16 q) {return (float)q / Q16_16_ONE;}
+        static float FromQ24_8(Q24_8 q) {return (float)q / Q24_8_ONE;}
+        static int32_t Q16_16ToInt(Q16_16 q, MapRounding rounding = MAP_ROUND_NEAREST) {return RoundShift(q, 16, rounding);}
+        static int32_t Q24_8ToInt(Q24_8 q, MapRounding rounding = MAP_ROUND_NEAREST) {return RoundShift(q, 8, rounding);}
+    private:
+        static int64_t MulDiv(int64_t a, int64_t b, int64_t c, MapRounding rounding);
+        static int32_t RoundShift(int32_t q, byte bits, MapRounding rounding);
 };
 
 
@@ -0,0 +1,183 @@
+//
+// Created by Andrew Simmons on 10/15/26.
+//
+
+#include "MotionPlanner.h"
+#include "StepperManager.h"
+
+MotionPlanner::MotionPlanner(StepperGroup *group) : group(group)
+{
+    syncPosition();
+}
+
+void MotionPlanner::setAcceleration(float acc)
+{
+    acceleration = acc < 0 ? -acc : acc;
+}
+
+void MotionPlanner::setJunctionDeviation(float steps)
+{
+    junctionDeviation = steps < 0 ? -steps : steps;
+}
+
+void MotionPlanner::syncPosition()
+{
+    for(byte i = 0; i < STEPPER_GROUP_MAX_AXES; i++)
+        position[i] = 0;
+    for(byte i = 0; i < group->getAxisCount(); i++)
+        position[i] = group->getStepper(i)->currentPosition();
+    hasPrevious = false;
+}
+
+bool MotionPlanner::isIdle() const
+{
+    return count == 0 && !group->isRunning();
+}
+
+bool MotionPlanner::addLine(const long *positions, float speed)
+{
+    if(isFull() || faulted || speed <= 0)
+        return false;
+
+    PlannerBlock *next = block(count);
+    float lengthSquared = 0;
+    long masterSteps = 0;
+    byte axisCount = group->getAxisCount();
+    for(byte i = 0; i < axisCount; i++)
+    {
+        next->deltas[i] = positions[i] - position[i];
+        lengthSquared += (float)next->deltas[i] * next->deltas[i];
+        long steps = next->deltas[i] < 0 ? -next->deltas[i] : next->deltas[i];
+        if(steps > masterSteps)
+            masterSteps = steps;
+    }
+    // Nothing to do, and it'd have no direction for the junction maths
+    if(masterSteps == 0)
+        return true;
+
+    next->length = sqrtf(lengthSquared);
+    next->masterSteps = masterSteps;
+    for(byte i = 0; i < axisCount; i++)
+    {
+        next->unit[i] = next->deltas[i] / next->length;
+        position[i] = positions[i];
+    }
+
+    next->nominalSpeed = speed;
+    next->fixed = false;
+    // Coming from a stop (or after the queue ran dry) there's no corner to carry speed through
+    float limit = speed < previousNominal ? speed : previousNominal;
+    next->maxEntrySpeed = hasPrevious ? junctionSpeed(previousUnit, next->unit, limit) : 0;
+    next->entrySpeed = 0;
+
+    for(byte i = 0; i < axisCount; i++)
+        previousUnit[i] = next->unit[i];
+    previousNominal = speed;
+    hasPrevious = true;
+    count++;
+
+    recalculate();
+    return true;
+}
+
+// Fastest speed through the corner where the path's deviation from it stays under
+// junctionDeviation given the centripetal acceleration, straight on = limit, reversing = 0
+float MotionPlanner::junctionSpeed(const float *fromUnit, const float *toUnit, float limit) const
+{
+    float cosTheta = 0;
+    for(byte i = 0; i < group->getAxisCount(); i++)
+        cosTheta -= fromUnit[i] * toUnit[i];
+
+    if(cosTheta < -0.999999f)
+        return limit;
+    if(cosTheta > 0.999999f)
+        return 0;
+
+    float sinHalfTheta = sqrtf(0.5f * (1.0f - cosTheta));
+    float speed = sqrtf(acceleration * junctionDeviation * sinHalfTheta / (1.0f - sinHalfTheta));
+    return speed < limit ? speed : limit;
+}
+
+void MotionPlanner::recalculate()
+{
+    if(count == 0)
+        return;
+
+    // Backward: everything has to be able to stop by the end of the queue
+    float exitSpeed = 0;
+    for(int i = count - 1; i >= 0; i--)
+    {
+        PlannerBlock *current = block(i);
+        if(current->fixed)
+            break;
+        float reachable = sqrtf(exitSpeed * exitSpeed + 2.0f * acceleration * current->length);
+        current->entrySpeed = current->maxEntrySpeed < reachable ? current->maxEntrySpeed : reachable;
+        exitSpeed = current->entrySpeed;
+    }
+
+    // Forward: can't enter faster than the block before could accelerate to
+    PlannerBlock *previous = block(0);
+    for(byte i = 1; i < count; i++)
+    {
+        PlannerBlock *current = block(i);
+        float reachable = sqrtf(previous->entrySpeed * previous->entrySpeed + 2.0f * acceleration * previous->length);
+        if(!current->fixed && current->entrySpeed > reachable)
+            current->entrySpeed = reachable;
+        previous = current;
+    }
+}
+
+// Pops the head block into the group. Speeds get scaled from path steps to master axis steps.
+void MotionPlanner::startNext()
+{
+    PlannerBlock *current = block(0);
+    float exit = count > 1 ? block(1)->entrySpeed : 0;
+    if(count > 1)
+        block(1)->fixed = true;
+
+    float scale = current->masterSteps / current->length;
+    group->moveSegment(current->deltas, current->entrySpeed * scale, current->nominalSpeed * scale, exit * scale,
+                       acceleration * scale);
+
+    head = (head + 1) % MOTION_PLANNER_BUFFER;
+    count--;
+    // This one stops at its end, so whatever gets queued next starts from a stop too
+    if(count == 0)
+        hasPrevious = false;
+}
+
+bool MotionPlanner::run()
+{
+    bool wasRunning = group->isRunning();
+    if(!group->run())
+    {
+        // Only a move that was going can have been cut short, the flag lasts until the next one
+        if(wasRunning && group->isLimitStopped())
+        {
+            fault();
+            return false;
+        }
+        if(count == 0)
+            return false;
+        startNext();
+        if(!group->run() && group->isLimitStopped())
+        {
+            fault();
+            return false;
+        }
+    }
+    return true;
+}
+
+void MotionPlanner::hardStop()
+{
+    group->hardStop();
+    count = 0;
+    syncPosition();
+}
+
+void MotionPlanner::fault()
+{
+    hardStop();
+    faulted = true;
+}
@@ -0,0 +1,72 @@
+//
+// Created by Andrew Simmons on 10/15/26.
+//
+
+#ifndef FIRMWORK_MOTIONPLANNER_H
+#define FIRMWORK_MOTIONPLANNER_H
+#include <Arduino.h>
+#include "StepperGroup.h"
+
+#define MOTION_PLANNER_BUFFER 16
+
+typedef struct PlannerBlock
+{
+    long deltas[STEPPER_GROUP_MAX_AXES];
+    float unit[STEPPER_GROUP_MAX_AXES]; // direction, for the junction angle
+    float length;         // steps along the path
+    long masterSteps;
+    float nominalSpeed;   // path steps/s
+    float maxEntrySpeed;  // junction/nominal limit
+    float entrySpeed;     // what the planner settled on
+    bool fixed;           // the block ahead is already executing towards this entry, don't replan it
+} PlannerBlock;
+
+// Lookahead queue in front of a StepperGroup. Lines are queued, and every time one is added the
+// entry speeds get replanned (backward pass from a stop at the end of the queue, then forward pass
+// from where we are) so corners are taken at the fastest speed acceleration allows instead of
+// stopping at each one. Speeds are in steps along the path, which assumes axes with equal steps/mm.
+class MotionPlanner
+{
+    public:
+        explicit MotionPlanner(StepperGroup *group);
+        // Path acceleration, steps/s^2
+        void setAcceleration(float acc);
+        // How far (steps) the path is allowed to round off a corner, bigger = faster corners.
+        // Same idea as Grbl's junction deviation.
+        void setJunctionDeviation(float steps);
+        // Absolute target, one entry per group axis. False when the buffer is full or faulted.
+        bool addLine(const long *positions, float speed);
+        bool run();
+        bool isIdle() const;
+        bool isFull() const {return count == MOTION_PLANNER_BUFFER;}
+        byte getQueued() const {return count;}
+        void hardStop();
+        // A limit switch cut a line short. The queue is dropped (every line after it assumed it
+        // got to its end), positions are re-read, and addLine() refuses until clearFault().
+        bool isFaulted() const {return faulted;}
+        void clearFault() {faulted = false;}
+        // Re-read the axes, for after something else moved them
+        void syncPosition();
+        // Where the last queued line ends (or the axis is, with nothing queued)
+        long getPlannedPosition(byte axis) const {return axis < STEPPER_GROUP_MAX_AXES ? position[axis] : 0;}
+    private:
+        StepperGroup *group;
+        PlannerBlock blocks[MOTION_PLANNER_BUFFER];
+        byte head = 0;
+        byte count = 0;
+        long position[STEPPER_GROUP_MAX_AXES];
+        float previousUnit[STEPPER_GROUP_MAX_AXES];
+        bool hasPrevious = false;
+        float previousNominal = 0;
+        float acceleration = 1000;
+        float junctionDeviation = 1;
+        bool faulted = false;
+        PlannerBlock *block(byte index) {return &blocks[(head + index) % MOTION_PLANNER_BUFFER];}
+        float junctionSpeed(const float *fromUnit, const float *toUnit, float limit) const;
+        void recalculate();
+        void startNext();
+        void fault();
+};
+
+
+#endif //FIRMWORK_MOTIONPLANNER_H
@@ -0,0 +1,53 @@
+//
+// Created by Andrew Simmons on 10/15/26.
+//
+
+#ifndef FIRMWORK_SPSCQUEUE_H
+#define FIRMWORK_SPSCQUEUE_H
+#include <Arduino.h>
+#include <atomic>
+
+// Fixed size ring for exactly one producer and one consumer, each of which can be an ISR or a
+// task on either core. No locks: the producer only writes head, the consumer only writes tail,
+// and release/acquire on those makes the slot contents visible before the index moves.
+// N has to be a power of two, the indices run free and wrap.
+template<typename T, uint32_t N>
+class SpscQueue
+{
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "SpscQueue size must be a power of two");
+    public:
+        // Producer side
+        bool IRAM_ATTR push(const T &item)
+        {
+            uint32_t h = head.load(std::memory_order_relaxed);
+            if(h - tail.load(std::memory_order_acquire) == N)
+                return false;
+            items[h & (N - 1)] = item;
+            head.store(h + 1, std::memory_order_release);
+            return true;
+        }
+        // Consumer side
+        bool IRAM_ATTR pop(T &item)
+        {
+            uint32_t t = tail.load(std::memory_order_relaxed);
+            if(t == head.load(std::memory_order_acquire))
+                return false;
+            item = items[t & (N - 1)];
+            tail.store(t + 1, std::memory_order_release);
+            return true;
+        }
+        // Exact from either side about its own end, a snapshot otherwise
+        uint32_t size() const {return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);}
+        bool isEmpty() const {return size() == 0;}
+        bool isFull() const {return size() >= N;}
+        uint32_t capacity() const {return N;}
+        // Only while neither side is using it
+        void clear() {tail.store(head.load(std::memory_order_relaxed), std::memory_order_relaxed);}
+    private:
+        T items[N];
+        std::atomic<uint32_t> head{0};
+        std::atomic<uint32_t> tail{0};
+};
+
+
+#endif //FIRMWORK_SPSCQUEUE_H
@@ -0,0 +1,187 @@
+//
+// Created by Andrew Simmons on 10/15/26.
+//
+
+#include "StepProfile.h"
+
+void StepProfile::setMaxSpeed(float speed)
+{
+    maxSpeed = speed < 0 ? -speed : speed;
+}
+
+void StepProfile::setAcceleration(float acc)
+{
+    acceleration = acc < 0 ? -acc : acc;
+}
+
+void StepProfile::setJerk(float pJerk)
+{
+    jerk = pJerk < 0 ? -pJerk : pJerk;
+}
+
+// Time to get from a stop to peak. The S-curve spends acc/jerk ramping acceleration up and the
+// same ramping it down, unless peak comes first, then it never reaches full acceleration.
+float StepProfile::rampTime(float peak) const
+{
+    if(shape == STEP_PROFILE_TRAPEZOID)
+        return peak / acceleration;
+    if(peak * jerk >= acceleration * acceleration)
+        return peak / acceleration + acceleration / jerk;
+    return 2.0f * sqrtf(peak / jerk);
+}
+
+// Both ramps are symmetric in acceleration, so the average speed is peak / 2
+float StepProfile::rampLength(float peak) const
+{
+    return peak * rampTime(peak) * 0.5f;
+}
+
+float StepProfile::rampPosition(float t, float peak) const
+{
+    if(shape == STEP_PROFILE_TRAPEZOID)
+        return 0.5f * acceleration * t * t;
+
+    float total = rampTime(peak);
+    float jerkTime = (peak * jerk >= acceleration * acceleration) ? acceleration / jerk : total * 0.5f;
+    float accPeak = jerk * jerkTime;
+    float endJerkUp = jerkTime;
+    float startJerkDown = total - jerkTime;
+    float vJerkUp = 0.5f * jerk * jerkTime * jerkTime;
+    float sJerkUp = jerk * jerkTime * jerkTime * jerkTime / 6.0f;
+
+    if(t <= endJerkUp)
+        return jerk * t * t * t / 6.0f;
+    if(t <= startJerkDown)
+    {
+        float dt = t - endJerkUp;
+        return sJerkUp + vJerkUp * dt + 0.5f * accPeak * dt * dt;
+    }
+    // Mirror of the jerk up phase, measured back from the end of the ramp
+    float dt = total - t;
+    return rampLength(peak) - peak * dt + jerk * dt * dt * dt / 6.0f;
+}
+
+float StepProfile::timeAtPosition(float position, float peak) const
+{
+    if(shape == STEP_PROFILE_TRAPEZOID)
+        return sqrtf(2.0f * position / acceleration);
+
+    float low = 0;
+    float high = rampTime(peak);
+    for(byte i = 0; i < 32; i++)
+    {
+        float mid = 0.5f * (low + high);
+        if(rampPosition(mid, peak) < position)
+            low = mid;
+        else
+            high = mid;
+    }
+    return 0.5f * (low + high);
+}
+
+void StepProfile::plan(long pSteps)
+{
+    steps = pSteps < 0 ? -pSteps : pSteps;
+    stepsDone = 0;
+    index = 0;
+    if(steps == 0 || maxSpeed <= 0 || acceleration <= 0 || jerk <= 0)
+    {
+        steps = 0;
+        rampSteps = 0;
+        return;
+    }
+
+    // Short moves never reach maxSpeed, find the peak where both ramps just fit
+    float peak = maxSpeed;
+    if(2.0f * rampLength(peak) > steps)
+    {
+        float low = 0;
+        float high = maxSpeed;
+        for(byte i = 0; i < 32; i++)
+        {
+            float mid = 0.5f * (low + high);
+            if(2.0f * rampLength(mid) > steps)
+                high = mid;
+            else
+                low = mid;
+        }
+        peak = low;
+    }
+
+    rampSteps = (long)rampLength(peak);
+    if(rampSteps < 1)
+        rampSteps = 1;
+    if(rampSteps * 2 > steps)
+        rampSteps = steps / 2;
+    stride = (rampSteps + STEP_PROFILE_TABLE_SIZE - 1) / STEP_PROFILE_TABLE_SIZE;
+    if(stride < 1)
+        stride = 1;
+
+    cruiseInterval = peak > 0 ? (uint32_t)(1000000.0f / peak + 0.5f) : 0;
+    // Each entry is the average interval over its chunk, from the times the chunk starts and ends.
+    // Step k lands at time(k + 1), so the first interval is the time to make the first step.
+    float previous = 0;
+    int entries = (int)((rampSteps + stride - 1) / stride);
+    for(int i = 0; i < entries; i++)
+    {
+        long end = (i + 1) * stride;
+        if(end > rampSteps)
+            end = rampSteps;
+        float t = timeAtPosition((float)end, peak);
+        float interval = (t - previous) * 1000000.0f / (end - i * stride);
+        previous = t;
+        table[i] = interval < cruiseInterval ? cruiseInterval : (uint32_t)(interval + 0.5f);
+    }
+
+    decelAt = steps - rampSteps;
+    strideLeft = stride;
+}
+
+uint32_t StepProfile::nextInterval()
+{
+    if(stepsDone >= steps)
+        return 0;
+
+    uint32_t interval;
+    if(stepsDone < rampSteps && stepsDone < decelAt)
+    {
+        interval = table[index];
+        if(--strideLeft == 0)
+        {
+            strideLeft = stride;
+            index++;
+        }
+    }
+    else if(stepsDone < decelAt)
+    {
+        interval = cruiseInterval;
+    }
+    else
+    {
+        // Backwards through the table, the last step uses entry 0
+        long remaining = steps - stepsDone - 1;
+        if(stepsDone == decelAt)
+        {
+            index = (int)(remaining / stride);
+            strideLeft = remaining % stride + 1;
+        }
+        interval = table[index];
+        if(--strideLeft == 0 && index > 0)
+        {
+            strideLeft = stride;
+            index--;
+        }
+    }
+    stepsDone++;
+    return interval;
+}
+
+void StepProfile::stop()
+{
+    if(stepsDone >= decelAt)
+        return;
+    // Steps it took to get here is how many it takes to stop
+    long toStop = stepsDone < rampSteps ? stepsDone : rampSteps;
+    steps = stepsDone + toStop;
+    decelAt = stepsDone;
+}
@@ -0,0 +1,62 @@
+//
+// Created by Andrew Simmons on 10/15/26.
+//
+
+#ifndef FIRMWORK_STEPPROFILE_H
+#define FIRMWORK_STEPPROFILE_H
+#include <Arduino.h>
+
+// Ramps longer than this get one entry per chunk of steps instead of one per step
+#define STEP_PROFILE_TABLE_SIZE 256
+
+typedef enum StepProfileShape
+{
+    STEP_PROFILE_TRAPEZOID,
+    STEP_PROFILE_SCURVE, // jerk limited, acceleration ramps up and down instead of stepping
+} StepProfileShape;
+
+// Step intervals worked out up front instead of per step. plan() does all the float maths and
+// fills a table with the accel ramp in whole microseconds, decel plays the same table backwards
+// and cruise is one constant, so nextInterval() is just counters and a table read.
+class StepProfile
+{
+    public:
+        void setShape(StepProfileShape pShape) {shape = pShape;}
+        // steps/s, steps/s^2, steps/s^3 (jerk only matters for STEP_PROFILE_SCURVE)
+        void setMaxSpeed(float speed);
+        void setAcceleration(float acc);
+        void setJerk(float pJerk);
+        // Builds the table for a move of |steps|, from and to a stop
+        void plan(long steps);
+        // Micros until the next step, 0 once the move is done
+        uint32_t nextInterval();
+        // Start decelerating from wherever we are
+        void stop();
+        bool isDone() const {return stepsDone >= steps;}
+        long getSteps() const {return steps;}
+        long getStepsDone() const {return stepsDone;}
+        long getRampSteps() const {return rampSteps;}
+        uint32_t getCruiseInterval() const {return cruiseInterval;}
+    private:
+        StepProfileShape shape = STEP_PROFILE_TRAPEZOID;
+        float maxSpeed = 1;
+        float acceleration = 1;
+        float jerk = 1;
+        uint32_t table[STEP_PROFILE_TABLE_SIZE];
+        long stride = 1;          // steps per table entry
+        long rampSteps = 0;
+        long steps = 0;
+        long stepsDone = 0;
+        long decelAt = 0;         // first step of the decel ramp
+        uint32_t cruiseInterval = 0;
+        // Where nextInterval() is in the table
+        int index = 0;
+        long strideLeft = 0;
+        float rampLength(float peak) const;
+        float rampTime(float peak) const;
+        float rampPosition(float t, float peak) const;
+        float timeAtPosition(float position, float peak) const;
+};
+
+
+#endif //FIRMWORK_STEPPROFILE_H
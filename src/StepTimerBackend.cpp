@@ -0,0 +1,294 @@
+//
+// Created by Andrew Simmons on 10/15/26.
+//
+
+#include "StepTimerBackend.h"
+#if defined(ESP_PLATFORM)
+#include "soc/gpio_reg.h"
+#include "soc/soc_caps.h"
+#endif
+
+// digitalWrite isn't in IRAM on every core, so tick() sets and clears the output registers itself
+static inline void IRAM_ATTR writePin(uint8_t pin, bool high)
+{
+#if defined(ESP_PLATFORM)
+    if(pin < 32)
+        REG_WRITE(high ? GPIO_OUT_W1TS_REG : GPIO_OUT_W1TC_REG, 1UL << pin);
+#if SOC_GPIO_PIN_COUNT > 32
+    else
+        REG_WRITE(high ? GPIO_OUT1_W1TS_REG : GPIO_OUT1_W1TC_REG, 1UL << (pin - 32));
+#endif
+#else
+    digitalWrite(pin, high ? HIGH : LOW);
+#endif
+}
+
+#if defined(ESP_PLATFORM)
+// The timer API takes a plain function, so one trampoline per hardware timer
+static StepTimerBackend *timerBackends[4];
+static void IRAM_ATTR onTimer0() {timerBackends[0]->tick();}
+static void IRAM_ATTR onTimer1() {timerBackends[1]->tick();}
+static void IRAM_ATTR onTimer2() {timerBackends[2]->tick();}
+static void IRAM_ATTR onTimer3() {timerBackends[3]->tick();}
+static void (*const timerHandlers[4])() = {onTimer0, onTimer1, onTimer2, onTimer3};
+#endif
+
+StepTimerBackend::StepTimerBackend(uint8_t stepPin, uint8_t dirPin, unsigned long tickMicros) :
+        stepPin(stepPin), dirPin(dirPin), tickMicros(tickMicros > 0 ? tickMicros : 1)
+{
+
+}
+
+bool StepTimerBackend::begin(uint8_t pTimerNumber)
+{
+    pinMode(stepPin, OUTPUT);
+    pinMode(dirPin, OUTPUT);
+    digitalWrite(stepPin, LOW);
+#if defined(ESP_PLATFORM)
+    if(pTimerNumber > 3 || timer != nullptr)
+        return false;
+    timerNumber = pTimerNumber;
+    timerBackends[timerNumber] = this;
+#if ESP_ARDUINO_VERSION_MAJOR >= 3
+    // Core 3.x picks the hardware timer itself, timerNumber only picks the trampoline
+    timer = timerBegin(1000000);
+    if(timer == nullptr)
+        return false;
+    timerAttachInterrupt(timer, timerHandlers[timerNumber]);
+    timerAlarm(timer, tickMicros, true, 0);
+#else
+    // 80MHz APB / 80 = 1 count per micro
+    timer = timerBegin(timerNumber, 80, true);
+    if(timer == nullptr)
+        return false;
+    timerAttachInterrupt(timer, timerHandlers[timerNumber], true);
+    timerAlarmWrite(timer, tickMicros, true);
+    timerAlarmEnable(timer);
+#endif
+#else
+    (void)pTimerNumber; // no hardware timers, service() ticks it
+    nextTick = VirtualClock::now() + tickMicros;
+    running = true;
+#endif
+    return true;
+}
+
+void StepTimerBackend::end()
+{
+#if defined(ESP_PLATFORM)
+    if(timer == nullptr)
+        return;
+#if ESP_ARDUINO_VERSION_MAJOR >= 3
+    timerStop(timer);
+#else
+    timerAlarmDisable(timer);
+#endif
+    timerDetachInterrupt(timer);
+    timerEnd(timer);
+    timer = nullptr;
+    timerBackends[timerNumber] = nullptr;
+#else
+    running = false;
+#endif
+    setLimitSwitches(nullptr, nullptr);
+    digitalWrite(stepPin, LOW);
+}
+
+void StepTimerBackend::setLimitSwitches(LimitSwitch *pLowLimit, LimitSwitch *pHighLimit)
+{
+    // Only let go of the trips that are still ours
+    if(lowLimit != nullptr && lowLimit->getTripBackend() == this)
+        lowLimit->setTripBackend(nullptr, false);
+    if(highLimit != nullptr && highLimit->getTripBackend() == this)
+        highLimit->setTripBackend(nullptr, true);
+    lowLimit = pLowLimit;
+    highLimit = pHighLimit;
+    if(lowLimit != nullptr)
+        lowLimit->setTripBackend(this, false);
+    if(highLimit != nullptr)
+        highLimit->setTripBackend(this, true);
+}
+
+void IRAM_ATTR StepTimerBackend::requestLimitAbort(bool towardForward)
+{
+    abortRequests.fetch_or(towardForward ? STEP_ABORT_FORWARD : STEP_ABORT_BACKWARD, std::memory_order_acq_rel);
+}
+
+bool StepTimerBackend::isIdle() const
+{
+    return queue.isEmpty() && !busy.load(std::memory_order_acquire);
+}
+
+void StepTimerBackend::flush()
+{
+    uint32_t request = flushRequested.fetch_add(1, std::memory_order_acq_rel) + 1;
+#if defined(ESP_PLATFORM)
+    // No timer running, no ISR to race with
+    if(timer == nullptr)
+    {
+        takeFlush();
+        return;
+    }
+    // A tick at most. The ISR bumps the request itself to abort, so wait to be caught up, not equal.
+    while((int32_t)(flushAcked.load(std::memory_order_acquire) - request) < 0);
+#else
+    // service() is the ISR here and runs on this thread, so nothing else is consuming
+    (void)request;
+    takeFlush();
+#endif
+}
+
+// Consumer side only
+void IRAM_ATTR StepTimerBackend::takeFlush()
+{
+    uint32_t request = flushRequested.load(std::memory_order_acquire);
+    if(request == flushAcked.load(std::memory_order_relaxed))
+        return;
+    StepEvent event;
+    while(queue.pop(event));
+    hasEvent = false;
+    due = 0;
+    busy.store(false, std::memory_order_release);
+    flushAcked.store(request, std::memory_order_release);
+}
+
+// The flush path, asked for from inside the ISR. No more steps are coming, so an empty queue
+// from here on isn't an underrun.
+void IRAM_ATTR StepTimerBackend::abortMove()
+{
+    streaming.store(false, std::memory_order_release);
+    limitAborts.fetch_add(1, std::memory_order_relaxed);
+    flushRequested.fetch_add(1, std::memory_order_acq_rel);
+    takeFlush();
+}
+
+// due counts down by a tick at a time and carries the overshoot into the next event, so
+// intervals that aren't a multiple of the tick still average out right over a move.
+// A step that comes due while the last pulse is still high waits a tick to keep a low gap.
+void IRAM_ATTR StepTimerBackend::tick()
+{
+    bool pulsed = pulseHigh;  // hold the step off this tick
+    if(pulseHigh)
+    {
+        writePin(stepPin, false);
+        pulseHigh = false;
+    }
+
+    if(flushRequested.load(std::memory_order_relaxed) != flushAcked.load(std::memory_order_relaxed))
+    {
+        takeFlush();
+        return;
+    }
+
+    if(!hasEvent)
+    {
+        StepEvent event;
+        if(!queue.pop(event))
+        {
+            if(streaming.load(std::memory_order_acquire))
+                underruns.fetch_add(1, std::memory_order_relaxed);
+            busy.store(false, std::memory_order_release);
+            abortRequests.store(0, std::memory_order_relaxed);
+            // Nothing to carry over, the next event counts from when it shows up
+            if(due < 0)
+                due = 0;
+            return;
+        }
+        busy.store(true, std::memory_order_release);
+        hasEvent = true;
+#if FIRMWORK_TELEMETRY
+        currentEvent = event;
+#endif
+        due += (long)(event & STEP_EVENT_INTERVAL_MASK);
+        bool eventForward = (event & STEP_EVENT_FORWARD) != 0;
+        if(eventForward != forward || stepCount.load(std::memory_order_relaxed) == 0)
+        {
+            forward = eventForward;
+            writePin(dirPin, forward);
+            // Drivers want dir settled before the step edge, give it a tick
+            pulsed = true;
+        }
+#if !defined(ESP_PLATFORM)
+        if(!idealStarted)
+        {
+            idealTime = tickTime;
+            idealStarted = true;
+        }
+        idealTime += event & STEP_EVENT_INTERVAL_MASK;
+#endif
+    }
+
+    // A switch's ISR asked, act on it now rather than at the step
+    if(abortRequests.load(std::memory_order_relaxed) != 0)
+    {
+        uint32_t requests = abortRequests.exchange(0, std::memory_order_acq_rel);
+        if(requests & (forward ? STEP_ABORT_FORWARD : STEP_ABORT_BACKWARD))
+        {
+            abortMove();
+            return;
+        }
+    }
+
+    due -= (long)tickMicros;
+    if(due > 0 || pulsed)
+        return;
+    // Last look before the edge, loop() may not have checked since the switch closed
+    if(limitReached(forward))
+    {
+        abortMove();
+        return;
+    }
+
+    writePin(stepPin, true);
+    pulseHigh = true;
+    hasEvent = false;
+    position.fetch_add(forward ? 1 : -1, std::memory_order_acq_rel);
+    stepCount.fetch_add(1, std::memory_order_relaxed);
+#if FIRMWORK_TELEMETRY
+    if(stamping.load(std::memory_order_relaxed))
+    {
+        // We're the only thing moving position while a move's queued
+        int32_t stepped = (int32_t)position.load(std::memory_order_relaxed);
+#if defined(ESP_PLATFORM)
+        StepStamp stamp = {(uint32_t)micros(), stepped, currentEvent};
+#else
+        StepStamp stamp = {(uint32_t)tickTime, stepped, currentEvent};
+#endif
+        if(!stamps.push(stamp))
+            droppedStamps.fetch_add(1, std::memory_order_relaxed);
+    }
+#endif
+#if !defined(ESP_PLATFORM)
+    unsigned long error = tickTime > idealTime ? tickTime - idealTime : idealTime - tickTime;
+    if(error > maxTimingError)
+        maxTimingError = error;
+#endif
+}
+
+#if !defined(ESP_PLATFORM)
+void StepTimerBackend::service()
+{
+    if(!running)
+        return;
+    unsigned long long now = VirtualClock::now();
+    while(nextTick <= now)
+    {
+        unsigned long late = 0;
+        if(jitter > 0)
+        {
+            // xorshift, repeatable run to run like the rest of the virtual time
+            jitterSeed ^= jitterSeed << 13;
+            jitterSeed ^= jitterSeed >> 17;
+            jitterSeed ^= jitterSeed << 5;
+            late = jitterSeed % (jitter + 1);
+        }
+        tickTime = nextTick + late;
+        tick();
+        nextTick += tickMicros;
+    }
+    // Finished, the next move's ideal schedule starts over. An underrun doesn't reset it, the
+    // stall shows up as timing error.
+    if(!streaming.load(std::memory_order_relaxed) && !busy.load(std::memory_order_relaxed) && !hasEvent)
+        idealStarted = false;
+}
+#endif
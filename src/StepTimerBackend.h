@@ -0,0 +1,152 @@
+//
+// Created by Andrew Simmons on 10/15/26.
+//
+
+#ifndef FIRMWORK_STEPTIMERBACKEND_H
+#define FIRMWORK_STEPTIMERBACKEND_H
+#include <Arduino.h>
+#include <atomic>
+#include "SpscQueue.h"
+#include "StepperTelemetry.h"
+#include "LimitSwitch.h"
+
+#define STEP_QUEUE_SIZE 128
+#define STEP_TIMER_DEFAULT_TICK_MICROS 10
+// Interval (micros since the previous step) in the low bits, direction in the top one
+#define STEP_EVENT_FORWARD 0x80000000UL
+#define STEP_EVENT_INTERVAL_MASK 0x7FFFFFFFUL
+
+typedef uint32_t StepEvent;
+
+#define STEP_ABORT_BACKWARD 0x1
+#define STEP_ABORT_FORWARD 0x2
+
+#if FIRMWORK_TELEMETRY
+// One step as the ISR put it out: its own timestamp, the position after it and the event it was
+typedef struct StepStamp
+{
+    uint32_t micros;
+    int32_t position;
+    StepEvent event;
+} StepStamp;
+#endif
+
+// Step pulses from a periodic timer interrupt instead of run() polling. Something (StepperManager)
+// fills a queue with step intervals ahead of time, the ISR counts them down every tick and pulses
+// step/dir pins (DRIVER wiring), so loop() only has to keep the queue topped up, not hit every step.
+// On the ESP32 it's a hardware timer, on the host ticks run off VirtualClock through service().
+class StepTimerBackend
+{
+    public:
+        StepTimerBackend(uint8_t stepPin, uint8_t dirPin, unsigned long tickMicros = STEP_TIMER_DEFAULT_TICK_MICROS);
+        // timerNumber is the ESP32 hardware timer (0-3) on core 2.x. Core 3.x allocates the timer
+        // itself, so there it only has to differ between backends. Ignored on the host.
+        bool begin(uint8_t timerNumber = 0);
+        void end();
+
+        // Producer side
+        bool push(StepEvent event) {return queue.push(event);}
+        bool isQueueFull() const {return queue.isFull();}
+        uint32_t getQueued() const {return queue.size();}
+        // Tell the ISR more steps are coming, an empty queue while this is set is an underrun
+        void setStreaming(bool pStreaming) {streaming.store(pStreaming, std::memory_order_release);}
+        // Nothing queued and nothing mid-step
+        bool isIdle() const;
+        // Drops whatever's queued and the step the ISR has in hand, and only returns once the ISR
+        // has done it, so nothing steps after. Only the consumer ever pops: this asks the ISR,
+        // which drains on its next tick. Call with streaming off and interrupts on, and don't
+        // push until it returns.
+        void flush();
+
+        // Switches the ISR looks at itself, the one it's stepping toward, right before each step.
+        // Closed or latched drops the move like flush() does, so a blocked loop() can't run the
+        // queue through a limit. Their interrupts (or sample()) also ask for it straight away,
+        // see requestLimitAbort(). Set before queuing, nullptr for none, both have to outlive us
+        // or be swapped out first.
+        void setLimitSwitches(LimitSwitch *pLowLimit, LimitSwitch *pHighLimit);
+        // From a switch's ISR: drop the move on the next tick if it's heading that way. Ignored
+        // moving away, and forgotten once the queue runs dry, a latch still covers the next move.
+        void IRAM_ATTR requestLimitAbort(bool towardForward);
+        // Moves the ISR dropped at a limit
+        unsigned long getLimitAborts() const {return limitAborts.load(std::memory_order_relaxed);}
+
+        long getPosition() const {return position.load(std::memory_order_acquire);}
+        void setPosition(long pos) {position.store(pos, std::memory_order_release);}
+        // Ticks that found the queue empty mid-move
+        unsigned long getUnderruns() const {return underruns.load(std::memory_order_relaxed);}
+        unsigned long getStepCount() const {return stepCount.load(std::memory_order_relaxed);}
+        unsigned long getTickMicros() const {return tickMicros;}
+
+        // The ISR body, one call per tick
+        void IRAM_ATTR tick();
+
+#if FIRMWORK_TELEMETRY
+        // With stamping on the ISR queues a StepStamp per step for StepperManager to turn into
+        // telemetry, so queued samples carry the real step times. No float in here, the ESP32
+        // can't use the FPU in an ISR. A full queue drops stamps, counted.
+        void setStamping(bool on) {stamping.store(on, std::memory_order_release);}
+        bool popStamp(StepStamp &stamp) {return stamps.pop(stamp);}
+        unsigned long getDroppedStamps() const {return droppedStamps.load(std::memory_order_relaxed);}
+#endif
+
+#if !defined(ESP_PLATFORM)
+        // Host only: runs every tick due up to VirtualClock::now(). Each tick can be made up to
+        // maxJitterMicros late (ISR latency), worst step timing error vs the queued intervals is
+        // tracked so jitter and underruns can be checked without hardware.
+        void service();
+        void setJitter(unsigned long maxJitterMicros) {jitter = maxJitterMicros;}
+        unsigned long getMaxTimingError() const {return maxTimingError;}
+#endif
+    private:
+        uint8_t stepPin;
+        uint8_t dirPin;
+        unsigned long tickMicros;
+        SpscQueue<StepEvent, STEP_QUEUE_SIZE> queue;
+        // ISR state
+        long due = 0;               // micros until the current event's step, goes <= 0 when it's time
+        bool hasEvent = false;
+        bool forward = true;
+        bool pulseHigh = false;
+        std::atomic<bool> busy{false};
+        std::atomic<bool> streaming{false};
+        std::atomic<long> position{0};
+        std::atomic<unsigned long> underruns{0};
+        std::atomic<unsigned long> stepCount{0};
+        // flush() bumps the request, the ISR drains and sets acked to match
+        std::atomic<uint32_t> flushRequested{0};
+        std::atomic<uint32_t> flushAcked{0};
+        void IRAM_ATTR takeFlush();
+        LimitSwitch *lowLimit = nullptr;
+        LimitSwitch *highLimit = nullptr;
+        std::atomic<unsigned long> limitAborts{0};
+        // STEP_ABORT_* bits from requestLimitAbort(), taken by the ISR
+        std::atomic<uint32_t> abortRequests{0};
+        bool limitReached(bool towardForward) const
+        {
+            LimitSwitch *limit = towardForward ? highLimit : lowLimit;
+            return limit != nullptr && limit->isTripped();
+        }
+        void IRAM_ATTR abortMove();
+#if FIRMWORK_TELEMETRY
+        StepEvent currentEvent = 0;
+        SpscQueue<StepStamp, STEP_QUEUE_SIZE> stamps;
+        std::atomic<bool> stamping{false};
+        std::atomic<unsigned long> droppedStamps{0};
+#endif
+#if defined(ESP_PLATFORM)
+        hw_timer_t *timer = nullptr;
+        uint8_t timerNumber = 0;
+#else
+        unsigned long long nextTick = 0;
+        unsigned long long tickTime = 0;   // when the current tick "ran", jitter included
+        unsigned long long idealTime = 0;  // when the current step should go out
+        bool idealStarted = false;
+        unsigned long jitter = 0;
+        unsigned long maxTimingError = 0;
+        bool running = false;
+        unsigned long jitterSeed = 1;
+#endif
+};
+
+
+#endif //FIRMWORK_STEPTIMERBACKEND_H
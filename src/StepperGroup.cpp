@@ -0,0 +1,215 @@
+//
+// Created by Andrew Simmons on 10/15/26.
+//
+
+#include "StepperGroup.h"
+
+bool StepperGroup::addStepper(StepperManager *manager)
+{
+    if(axisCount >= STEPPER_GROUP_MAX_AXES || running)
+        return false;
+    axes[axisCount].manager = manager;
+    axes[axisCount].steps = 0;
+    axes[axisCount].error = 0;
+    axes[axisCount].forward = true;
+    axisCount++;
+    return true;
+}
+
+void StepperGroup::setMaxSpeed(float speed)
+{
+    maxSpeed = speed < 0 ? -speed : speed;
+}
+
+void StepperGroup::setAcceleration(float acc)
+{
+    acceleration = acc < 0 ? -acc : acc;
+}
+
+void StepperGroup::moveToAbsolute(const long *positions)
+{
+    long deltas[STEPPER_GROUP_MAX_AXES];
+    for(byte i = 0; i < axisCount; i++)
+        deltas[i] = positions[i] - axes[i].manager->currentPosition();
+    moveRelative(deltas);
+}
+
+void StepperGroup::moveRelative(const long *deltas)
+{
+    setAxes(deltas);
+    begin(0, maxSpeed, 0, acceleration);
+}
+
+void StepperGroup::moveSegment(const long *deltas, float entrySpeed, float cruiseSpeed, float exitSpeed, float acc)
+{
+    setAxes(deltas);
+    begin(entrySpeed, cruiseSpeed, exitSpeed, acc);
+}
+
+void StepperGroup::setAxes(const long *deltas)
+{
+    for(byte i = 0; i < axisCount; i++)
+    {
+        axes[i].forward = deltas[i] >= 0;
+        axes[i].steps = deltas[i] >= 0 ? deltas[i] : -deltas[i];
+    }
+}
+
+void StepperGroup::begin(float entrySpeed, float cruiseSpeed, float exitSpeed, float acc)
+{
+    masterSteps = 0;
+    for(byte i = 0; i < axisCount; i++)
+    {
+        if(axes[i].steps > masterSteps)
+            masterSteps = axes[i].steps;
+    }
+    if(masterSteps == 0 || cruiseSpeed <= 0 || acc <= 0)
+    {
+        finish();
+        return;
+    }
+
+    for(byte i = 0; i < axisCount; i++)
+    {
+        // Start half way so the slave steps land centered between master steps
+        axes[i].error = masterSteps / 2;
+        axes[i].manager->beginDirectStepping();
+    }
+
+    masterTotal = masterSteps;
+    masterDone = 0;
+    limitStopped = false;
+    // Austin: n steps into a ramp from standstill is speed^2 / 2a
+    c0 = 0.676f * sqrtf(2.0f / acc) * 1000000.0f;
+    cmin = 1000000.0f / cruiseSpeed;
+    nExit = (long)((exitSpeed * exitSpeed) / (2.0f * acc));
+    if(entrySpeed > 0)
+    {
+        n = (long)((entrySpeed * entrySpeed) / (2.0f * acc));
+        cn = 1000000.0f / entrySpeed;
+    }
+    else
+    {
+        n = 0;
+        cn = c0;
+    }
+    if(cn < cmin)
+        cn = cmin;
+
+    // Carrying on from a segment that left at speed, the first step is one interval after its last,
+    // otherwise it goes out on the next run()
+    if(!(flowing && entrySpeed > 0))
+        lastStepMicros = (uint32_t)micros() - (uint32_t)cn;
+    flowing = false;
+    running = true;
+}
+
+void StepperGroup::finish(bool keepStepping)
+{
+    running = false;
+    flowing = keepStepping;
+    if(keepStepping)
+        return;
+    for(byte i = 0; i < axisCount; i++)
+        axes[i].manager->endDirectStepping();
+}
+
+uint32_t StepperGroup::getMicrosToNextStep() const
+{
+    if(!running)
+        return UINT32_MAX;
+    uint32_t since = (uint32_t)micros() - lastStepMicros;
+    return since < (uint32_t)cn ? (uint32_t)cn - since : 0;
+}
+
+bool StepperGroup::run()
+{
+    if(!running)
+        return false;
+
+    // Any axis blocked by its limit stops the whole line, anything else would bend it
+    for(byte i = 0; i < axisCount; i++)
+    {
+        if(axes[i].steps > 0 && axes[i].manager->limitBlocks(axes[i].forward))
+        {
+            hardStop();
+            axes[i].manager->clearLimitLatch(axes[i].forward);
+            limitStopped = true;
+            return false;
+        }
+    }
+
+    uint32_t now = micros();
+    if((uint32_t)(now - lastStepMicros) < (uint32_t)cn)
+        return true;
+    lastStepMicros = now;
+
+    for(byte i = 0; i < axisCount; i++)
+    {
+        StepperGroupAxis *axis = &axes[i];
+        axis->error += axis->steps;
+        if(axis->error >= masterSteps)
+        {
+            axis->error -= masterSteps;
+            axis->manager->stepOnce(axis->forward, now);
+        }
+    }
+
+    masterDone++;
+    if(masterDone >= masterTotal)
+    {
+        finish(nExit > 0 && masterTotal == masterSteps);
+        return false;
+    }
+    advanceProfile();
+    return true;
+}
+
+// Austin's recurrence: c(n) = c(n-1) - 2c(n-1)/(4n+1). While accelerating/cruising n is also how
+// many steps it'd take to stop, so decel starts once that's all we have left.
+void StepperGroup::advanceProfile()
+{
+    long remaining = masterTotal - masterDone;
+    if(n > 0 && remaining <= n - nExit)
+        n = -n;
+
+    if(n < 0)
+    {
+        // Hold at n = -1, one more step of the recurrence would flip the interval negative
+        if(n < -1)
+        {
+            cn = cn - (2.0f * cn) / (4.0f * n + 1.0f);
+            n++;
+        }
+    }
+    else if(cn > cmin)
+    {
+        n++;
+        cn = cn - (2.0f * cn) / (4.0f * n + 1.0f);
+        if(cn < cmin)
+            cn = cmin;
+    }
+}
+
+void StepperGroup::stop()
+{
+    if(!running)
+        return;
+    nExit = 0;
+    if(n > 0)
+    {
+        long stopAt = masterDone + n;
+        if(stopAt < masterTotal)
+            masterTotal = stopAt;
+    }
+    else if(n == 0)
+    {
+        hardStop();
+    }
+}
+
+void StepperGroup::hardStop()
+{
+    if(running || flowing)
+        finish();
+}
@@ -0,0 +1,77 @@
+//
+// Created by Andrew Simmons on 10/15/26.
+//
+
+#ifndef FIRMWORK_STEPPERGROUP_H
+#define FIRMWORK_STEPPERGROUP_H
+#include <Arduino.h>
+#include "StepperManager.h"
+
+#define STEPPER_GROUP_MAX_AXES 4
+
+typedef struct StepperGroupAxis
+{
+    StepperManager *manager;
+    long steps;     // |delta| for the current move
+    long error;     // Bresenham accumulator
+    bool forward;
+} StepperGroupAxis;
+
+// Straight line moves across several StepperManagers. The axis with the most steps is the master,
+// it gets a trapezoid profile (same Austin stepping AccelStepper uses) and every other axis is
+// Bresenham'd off its steps, so they all start and arrive together. One run() drives every axis.
+class StepperGroup
+{
+    public:
+        bool addStepper(StepperManager *manager);
+        byte getAxisCount() const {return axisCount;}
+        StepperManager *getStepper(byte axis) const {return axes[axis].manager;}
+        // Along the master axis, in steps
+        void setMaxSpeed(float speed);
+        void setAcceleration(float acc);
+        // One entry per axis, in the order they were added
+        void moveToAbsolute(const long *positions);
+        void moveRelative(const long *deltas);
+        // For MotionPlanner: a relative move that enters/leaves at speed instead of stopping.
+        // Speeds and acc are master axis steps/s, a segment that exits above 0 keeps the steppers
+        // and the step timing so the next segment carries straight on.
+        void moveSegment(const long *deltas, float entrySpeed, float cruiseSpeed, float exitSpeed, float acc);
+        bool run();
+        bool isRunning() const {return running;}
+        // The last move was cut short because an axis hit its limit, until the next move starts.
+        // Every axis stopped where it was, short of the target.
+        bool isLimitStopped() const {return limitStopped;}
+        void stop();     // decelerate along the line
+        void hardStop(); // right now
+        long getMasterSteps() const {return masterSteps;}
+        long getMasterStepsDone() const {return masterDone;}
+        // Master step interval the profile is on right now, in micros
+        float getStepInterval() const {return cn;}
+        float getSpeed() const {return running ? 1000000.0f / cn : 0;}
+        // Micros until run() steps again, 0 if it's due, UINT32_MAX when there's no move
+        uint32_t getMicrosToNextStep() const;
+    private:
+        StepperGroupAxis axes[STEPPER_GROUP_MAX_AXES];
+        byte axisCount = 0;
+        float maxSpeed = 1;
+        float acceleration = 1;
+        bool running = false;
+        long masterSteps = 0;  // Bresenham denominator, the full move
+        long masterTotal = 0;  // where we'll actually stop, less than masterSteps after stop()
+        long masterDone = 0;
+        long n = 0;            // steps into the ramp, negative while decelerating
+        float c0 = 0;
+        float cn = 0;
+        float cmin = 0;
+        long nExit = 0;        // n at the exit speed, decel stops there
+        bool flowing = false;  // last segment left at speed, keep its timing
+        bool limitStopped = false;
+        uint32_t lastStepMicros = 0; // micros(), only ever subtracted so it wraps cleanly
+        void setAxes(const long *deltas);
+        void begin(float entrySpeed, float cruiseSpeed, float exitSpeed, float acc);
+        void finish(bool keepStepping = false);
+        void advanceProfile();
+};
+
+
+#endif //FIRMWORK_STEPPERGROUP_H
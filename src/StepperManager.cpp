@@ -26,6 +26,7 @@ void StepperManager::setAcceleration(float acc)
 
 void StepperManager::moveToAbsolute(long pos, float speed)
 {
+    endDirectStepping();
     mode = STEPPER_MOVE_TO;
     stepper->moveTo(pos);
     stepper->setMaxSpeed(speed);
@@ -34,18 +35,21 @@ void StepperManager::moveToAbsolute(long pos, float speed)
 
 void StepperManager::moveToAbsolute(long pos)
 {
+    endDirectStepping();
     mode = STEPPER_MOVE_TO;
     stepper->moveTo(pos);
 }
 
 void StepperManager::moveRelative(long pos)
 {
+    endDirectStepping();
     mode = STEPPER_MOVE_TO;
     stepper->move(pos);
 }
 
 void StepperManager::moveRelative(long pos, float speed)
 {
+    endDirectStepping();
     mode = STEPPER_MOVE_TO;
     stepper->move(pos);
     stepper->setSpeed(speed);
@@ -53,12 +57,30 @@ void StepperManager::moveRelative(long pos, float speed)
 
 void StepperManager::moveAtSpeed(float speed)
 {
+    endDirectStepping();
     stepper->setSpeed(speed);
     mode = STEPPER_MOVE_SPEED;
 }
 
 void StepperManager::stop()
 {
+    if(mode == STEPPER_HOMING)
+    {
+        endHoming(HOMING_IDLE);
+        return;
+    }
+    if(mode == STEPPER_PROFILE)
+        endDirectStepping();
+    else if(mode == STEPPER_QUEUED)
+    {
+        // flush() waits for the ISR to drop the queue and its step in hand, so the position
+        // is final as soon as it returns
+        backend->setStreaming(false);
+        backend->flush();
+        profile->plan(0);
+        endQueued();
+        return;
+    }
     stepper->stop();
     stepper->setSpeed(0);
     mode = STEPPER_NONE;
@@ -66,6 +88,14 @@ void StepperManager::stop()
 
 void StepperManager::softStop()
 {
+    if(mode == STEPPER_PROFILE || mode == STEPPER_QUEUED)
+    {
+        // Anything already queued still goes out, the decel starts after it
+        long before = profile->getSteps();
+        profile->stop();
+        profileTarget -= (profileForward ? 1 : -1) * (before - profile->getSteps());
+        return;
+    }
     stepper->stop();
 //    stepper->setSpeed(0);
 //    mode = STEPPER_NONE;
@@ -73,40 +103,84 @@ void StepperManager::softStop()
 
 void StepperManager::setCurrentPosition(long pos)
 {
+    directPosition = pos;
     stepper->setCurrentPosition(pos);
 }
 
+// AccelStepper isn't timing the table/ISR/direct modes, so their speed comes from their own
+// intervals. Queued, it's the last interval queued, a queue's worth ahead of the ISR.
 float StepperManager::speed()
 {
+    if(mode == STEPPER_PROFILE || mode == STEPPER_QUEUED)
+        return profileInterval > 0 ? (profileForward ? 1000000.0f : -1000000.0f) / profileInterval : 0;
+    if(mode == STEPPER_DIRECT)
+        return directInterval > 0 ? (directForward ? 1000000.0f : -1000000.0f) / directInterval : 0;
     return stepper->speed();
 }
 
 bool StepperManager::run(bool overrideLimits)
 {
-    if(limitFunction != nullptr && !overrideLimits)
+    bool running = runMotion(overrideLimits);
+#if FIRMWORK_TELEMETRY
+    if(telemetry != nullptr)
+        recordTelemetry();
+#endif
+    return running;
+}
+
+// Forced inline so run() without telemetry is exactly what it was, no extra call
+__attribute__((always_inline)) inline bool StepperManager::runMotion(bool overrideLimits)
+{
+    StepperCommand command;
+    while(commands.pop(command))
+        applyCommand(command);
+
+    if(mode == STEPPER_PROFILE)
     {
-        if(limitFunction())
+        if(!overrideLimits && limitBlocks(profileForward))
         {
-            // Limit hit
-            if(limitMode == LIMIT_LOW)
-            {
-                if((mode == STEPPER_MOVE_TO &&  (targetPosition() < currentPosition())) ||
-                   (mode == STEPPER_MOVE_SPEED &&  speed() < 0)) {
-                    stop(); // hmm
-                    return false;
-                }
-            }
-            else if(limitMode == LIMIT_HIGH)
-            {
-                if((mode == STEPPER_MOVE_TO &&  (targetPosition() > currentPosition())) ||
-                   (mode == STEPPER_MOVE_SPEED &&  speed() > 0)) {
-                    stop(); // hmm
-                    return false;
-                }
-            }
+            limitStop(profileForward);
+            return false;
+        }
+        runProfile();
+        return true;
+    }
+    if(mode == STEPPER_HOMING)
+    {
+        runHoming();
+        return mode == STEPPER_HOMING;
+    }
+    if(mode == STEPPER_QUEUED)
+    {
+        if(!overrideLimits && limitBlocks(profileForward))
+        {
+            limitStop(profileForward);
+            return false;
+        }
+        runQueued();
+        return true;
+    }
+
+    // Only work out which way we're going once something's actually closed
+    if(!overrideLimits && anyLimitActive())
+    {
+        int8_t direction = runDirection();
+        // anyLimitActive() already called limitFunction, it's only the side left to check
+        if(direction != 0 && (lowLimit != nullptr || highLimit != nullptr ? limitBlocks(direction > 0) :
+                              limitMode == (direction > 0 ? LIMIT_HIGH : LIMIT_LOW)))
+        {
+            limitStop(direction > 0);
+            return false;
         }
     }
 
+    if(handoffPending && mode != STEPPER_NONE)
+    {
+        if(handoffWait() > 0)
+            return true;
+        handoffPending = false;
+    }
+
     if(mode == STEPPER_MOVE_TO)
         stepper->run();
     else if(mode == STEPPER_MOVE_SPEED)
@@ -117,17 +191,25 @@ bool StepperManager::run(bool overrideLimits)
 
 long StepperManager::targetPosition()
 {
+    if(mode == STEPPER_PROFILE || mode == STEPPER_QUEUED)
+        return profileTarget;
     return stepper->targetPosition();
 }
 
 long StepperManager::distanceToGo()
 {
+    if(mode == STEPPER_PROFILE || mode == STEPPER_QUEUED)
+        return profileTarget - currentPosition();
     return stepper->distanceToGo();
 }
 
 
 long StepperManager::currentPosition()
 {
+    if(mode == STEPPER_QUEUED)
+        return backend->getPosition();
+    if(mode == STEPPER_DIRECT || mode == STEPPER_PROFILE)
+        return directPosition;
     return stepper->currentPosition();
 }
 
@@ -138,4 +220,437 @@ StepperManager::StepperManager(AccelStepper *pStepper, boolean (*pLimitFunction)
     limitMode = pLimitMode;
 }
 
+void StepperManager::setLimitSwitches(LimitSwitch *pLowLimit, LimitSwitch *pHighLimit)
+{
+    lowLimit = pLowLimit;
+    highLimit = pHighLimit;
+}
+
+// A switch also blocks on a latched hit, so one that closed and opened again between two polls
+// still stops us. Heading away from the other switch means whatever it latched is behind us
+// (backing off it, or bounce on the way), so that latch goes.
+bool StepperManager::limitBlocks(bool forward)
+{
+    if(lowLimit != nullptr || highLimit != nullptr)
+    {
+        LimitSwitch *behind = forward ? lowLimit : highLimit;
+        if(behind != nullptr && behind->wasTriggered())
+            behind->clearLatch();
+        LimitSwitch *limit = forward ? highLimit : lowLimit;
+        return limit != nullptr && (limit->isActive() || limit->wasTriggered());
+    }
+    return limitClosed(forward);
+}
+
+// Only once the stop for a hit has been dealt with, a latch cleared any earlier could miss one
+void StepperManager::clearLimitLatch(bool forward)
+{
+    LimitSwitch *limit = forward ? highLimit : lowLimit;
+    if(limit != nullptr)
+        limit->clearLatch();
+}
 
+// Closed right now, latch or not
+bool StepperManager::limitClosed(bool forward)
+{
+    LimitSwitch *limit = forward ? highLimit : lowLimit;
+    if(limit != nullptr)
+        return limit->isActive();
+    if(lowLimit != nullptr || highLimit != nullptr)
+        return false;
+    if(limitFunction == nullptr || limitMode != (forward ? LIMIT_HIGH : LIMIT_LOW))
+        return false;
+    return limitFunction();
+}
+
+// Something that can say a limit that way is closed, whatever it says right now
+bool StepperManager::hasLimit(bool forward) const
+{
+    if(lowLimit != nullptr || highLimit != nullptr)
+        return (forward ? highLimit : lowLimit) != nullptr;
+    return limitFunction != nullptr && limitMode == (forward ? LIMIT_HIGH : LIMIT_LOW);
+}
+
+void StepperManager::limitStop(bool forward)
+{
+    stop();
+    clearLimitLatch(forward);
+}
+
+// Which way run() would step for MOVE_TO/MOVE_SPEED, 0 if it won't
+int8_t StepperManager::runDirection()
+{
+    if(mode == STEPPER_MOVE_TO)
+    {
+        long distance = stepper->distanceToGo();
+        return distance > 0 ? 1 : (distance < 0 ? -1 : 0);
+    }
+    if(mode == STEPPER_MOVE_SPEED)
+    {
+        float currentSpeed = stepper->speed();
+        return currentSpeed > 0 ? 1 : (currentSpeed < 0 ? -1 : 0);
+    }
+    return 0;
+}
+
+void StepperManager::beginDirectStepping()
+{
+    if(mode == STEPPER_DIRECT || mode == STEPPER_PROFILE)
+        return;
+    // Drop whatever AccelStepper was doing, from here on the position is ours until endDirectStepping()
+    stepper->setCurrentPosition(stepper->currentPosition());
+    directPosition = stepper->currentPosition();
+    directInterval = 0;
+    handoffPending = false;
+    setDirectDirection(true);
+    mode = STEPPER_DIRECT;
+}
+
+// A token 1 step/s, only so AccelStepper's direction (the DIR pin, or FUNCTION wiring's
+// forward/backward) follows. Nothing is timed off it.
+void StepperManager::setDirectDirection(bool forward)
+{
+    directForward = forward;
+    stepper->setSpeed(forward ? 1 : -1);
+}
+
+void StepperManager::stepOnce(bool forward)
+{
+    stepOnce(forward, micros());
+}
+
+void StepperManager::stepOnce(bool forward, uint32_t now)
+{
+    directInterval = now - directLastStep;
+    directLastStep = now;
+    stepDirect(forward);
+}
+
+void StepperManager::endDirectStepping()
+{
+    if(mode != STEPPER_DIRECT && mode != STEPPER_PROFILE)
+        return;
+    // Hand the position back, and make it the target so run() won't go anywhere
+    stepper->setCurrentPosition(directPosition);
+    handoffStep = mode == STEPPER_PROFILE ? profileLastStep : directLastStep;
+    handoffPending = true;
+    mode = STEPPER_NONE;
+}
+
+// Micros left before AccelStepper may take its first step, one of its intervals after our last
+uint32_t StepperManager::handoffWait() const
+{
+    float currentSpeed = fabsf(stepper->speed());
+    if(currentSpeed == 0)
+        return 0;
+    uint32_t interval = (uint32_t)(1000000.0f / currentSpeed);
+    uint32_t since = (uint32_t)micros() - handoffStep;
+    return since < interval ? interval - since : 0;
+}
+
+bool StepperManager::moveProfiled(long pos)
+{
+    if(profile == nullptr)
+        return false;
+    if(mode == STEPPER_PROFILE)
+        endDirectStepping();
+    else if(mode == STEPPER_QUEUED)
+        stop();
+
+    long delta = pos - currentPosition();
+    profile->plan(delta);
+    if(delta == 0)
+        return true;
+
+    beginDirectStepping();
+    mode = STEPPER_PROFILE;
+    profileTarget = pos;
+    profileForward = delta > 0;
+    // First step goes out one interval from now
+    profileInterval = profile->nextInterval();
+    profileLastStep = micros();
+    return true;
+}
+
+// Only a subtract and compare between steps, the next interval is a table read
+void StepperManager::runProfile()
+{
+    // 32 bits throughout, micros() wraps every 71.6 minutes
+    uint32_t now = micros();
+    uint32_t late = now - profileLastStep;
+    if(late < profileInterval)
+        return;
+    stepDirect(profileForward);
+    // Off the deadline rather than now, so a little polling jitter doesn't stretch the move.
+    // More than a whole interval behind and we'd burst to catch up, so start over from now.
+    profileLastStep = late - profileInterval < profileInterval ? profileLastStep + profileInterval : now;
+    profileInterval = profile->nextInterval();
+    if(profileInterval == 0)
+        endDirectStepping();
+}
+
+uint32_t StepperManager::getMicrosToNextStep() const
+{
+    if(mode == STEPPER_PROFILE)
+    {
+        uint32_t late = (uint32_t)micros() - profileLastStep;
+        return late < profileInterval ? profileInterval - late : 0;
+    }
+    if(handoffPending && (mode == STEPPER_MOVE_TO || mode == STEPPER_MOVE_SPEED))
+    {
+        uint32_t wait = handoffWait();
+        if(wait > 0)
+            return wait;
+    }
+    return UINT32_MAX;
+}
+
+bool StepperManager::moveQueued(long pos)
+{
+    if(profile == nullptr || backend == nullptr)
+        return false;
+    if(mode == STEPPER_PROFILE)
+        endDirectStepping();
+    else if(mode == STEPPER_QUEUED)
+        stop();
+
+    // stop() left AccelStepper with the backend's final count, so it's right either way
+    long delta = pos - currentPosition();
+    profile->plan(delta);
+    if(delta == 0)
+        return true;
+
+    backend->setPosition(stepper->currentPosition());
+    backend->setLimitSwitches(lowLimit, highLimit);
+#if FIRMWORK_TELEMETRY
+    backend->setStamping(telemetry != nullptr);
+#endif
+    mode = STEPPER_QUEUED;
+    profileTarget = pos;
+    profileForward = delta > 0;
+    runQueued();
+    backend->setStreaming(!profile->isDone());
+    return true;
+}
+
+void StepperManager::runQueued()
+{
+    StepEvent direction = profileForward ? STEP_EVENT_FORWARD : 0;
+    while(!profile->isDone() && !backend->isQueueFull())
+    {
+        profileInterval = profile->nextInterval();
+        backend->push(direction | profileInterval);
+    }
+    if(profile->isDone())
+    {
+        backend->setStreaming(false);
+        if(backend->isIdle())
+            endQueued();
+    }
+}
+
+// Hand the position back to AccelStepper, it never saw the steps
+void StepperManager::endQueued()
+{
+    stepper->setCurrentPosition(backend->getPosition());
+    mode = STEPPER_NONE;
+}
+
+bool StepperManager::postCommand(StepperCommandType type, long position, float speed)
+{
+    StepperCommand command = {type, position, speed};
+    return commands.push(command);
+}
+
+void StepperManager::applyCommand(const StepperCommand &command)
+{
+    switch(command.type)
+    {
+        case STEPPER_COMMAND_MOVE_TO:
+            if(command.speed > 0)
+                moveToAbsolute(command.position, command.speed);
+            else
+                moveToAbsolute(command.position);
+            break;
+        case STEPPER_COMMAND_MOVE_RELATIVE:
+            if(command.speed > 0)
+                moveRelative(command.position, command.speed);
+            else
+                moveRelative(command.position);
+            break;
+        case STEPPER_COMMAND_MOVE_SPEED:
+            moveAtSpeed(command.speed);
+            break;
+        case STEPPER_COMMAND_STOP:
+            stop();
+            break;
+        case STEPPER_COMMAND_SOFT_STOP:
+            softStop();
+            break;
+        case STEPPER_COMMAND_SET_MAX_SPEED:
+            setMaxSpeed(command.speed);
+            break;
+        case STEPPER_COMMAND_SET_ACCELERATION:
+            setAcceleration(command.speed);
+            break;
+        case STEPPER_COMMAND_SET_POSITION:
+            setCurrentPosition(command.position);
+            break;
+    }
+    commandsApplied++;
+}
+
+bool StepperManager::home(const HomingConfig &config)
+{
+    if(config.fastSpeed <= 0 || config.slowSpeed <= 0 || !hasLimit(config.towardHigh))
+        return false;
+    if(mode == STEPPER_PROFILE || mode == STEPPER_QUEUED)
+        stop();
+    homing = config;
+    homingRetried = false;
+    if(mode != STEPPER_HOMING)
+        savedMaxSpeed = stepper->maxSpeed();
+    // setSpeed() is capped at maxSpeed
+    stepper->setMaxSpeed(homing.fastSpeed > homing.slowSpeed ? homing.fastSpeed : homing.slowSpeed);
+    mode = STEPPER_HOMING;
+    // Already sat on the switch, skip straight to getting off it
+    if(limitClosed(homing.towardHigh))
+    {
+        homingState = HOMING_BACKOFF;
+        homingMove(homing.towardHigh ? -homing.backoffSteps : homing.backoffSteps, homing.fastSpeed);
+    }
+    else
+    {
+        homingState = HOMING_FAST_SEEK;
+        homingSeek(homing.fastSpeed);
+    }
+    return true;
+}
+
+// Constant speed the whole way, AccelStepper's runSpeed()/runSpeedToPosition() do the stepping
+void StepperManager::homingSeek(float speed)
+{
+    homingStart = stepper->currentPosition();
+    stepper->setSpeed(homing.towardHigh ? speed : -speed);
+}
+
+void StepperManager::homingMove(long steps, float speed)
+{
+    stepper->move(steps);
+    stepper->setSpeed(steps >= 0 ? speed : -speed);
+}
+
+void StepperManager::endHoming(HomingState state)
+{
+    stepper->setCurrentPosition(stepper->currentPosition());
+    stepper->setMaxSpeed(savedMaxSpeed);
+    homingState = state;
+    mode = STEPPER_NONE;
+}
+
+void StepperManager::runHoming()
+{
+    bool toward = homing.towardHigh;
+    long away = toward ? -1 : 1;
+    switch(homingState)
+    {
+        case HOMING_FAST_SEEK:
+        case HOMING_SLOW_SEEK:
+            if(limitBlocks(toward))
+            {
+                if(homingState == HOMING_FAST_SEEK)
+                {
+                    homingState = HOMING_BACKOFF;
+                    homingMove(away * homing.backoffSteps, homing.fastSpeed);
+                }
+                else
+                {
+                    homingState = HOMING_OFFSET;
+                    homingMove(away * homing.offsetSteps, homing.slowSpeed);
+                }
+                clearLimitLatch(toward);
+                return;
+            }
+            if(homing.maxTravel > 0 && labs(stepper->currentPosition() - homingStart) >= homing.maxTravel)
+            {
+                endHoming(HOMING_FAILED);
+                return;
+            }
+            stepper->runSpeed();
+            break;
+        case HOMING_BACKOFF:
+            if(limitBlocks(!toward))
+            {
+                endHoming(HOMING_FAILED);
+                clearLimitLatch(!toward);
+                return;
+            }
+            if(stepper->distanceToGo() == 0)
+            {
+                // Still closed after the full back off, give it the same again at slow speed
+                if(limitClosed(toward))
+                {
+                    if(homingRetried)
+                    {
+                        endHoming(HOMING_FAILED);
+                        return;
+                    }
+                    homingRetried = true;
+                    homingMove(away * homing.backoffSteps, homing.slowSpeed);
+                    return;
+                }
+                homingState = HOMING_SLOW_SEEK;
+                homingSeek(homing.slowSpeed);
+                return;
+            }
+            stepper->runSpeedToPosition();
+            break;
+        case HOMING_OFFSET:
+            if(stepper->distanceToGo() == 0)
+            {
+                stepper->setCurrentPosition(homing.homePosition);
+                endHoming(HOMING_DONE);
+                return;
+            }
+            stepper->runSpeedToPosition();
+            break;
+        default:
+            endHoming(homingState);
+            break;
+    }
+}
+
+#if FIRMWORK_TELEMETRY
+// Only when the position moved, so it's one sample per step. Queued, the ISR stamped each step
+// as it went out and those become the samples; polling here would time them off the main loop
+// and a queue's worth ahead. Their limit bits are as of this run().
+void StepperManager::recordTelemetry()
+{
+    auto limits = [this]() -> uint8_t {
+        return (limitClosed(false) ? TELEMETRY_LIMIT_LOW : 0) | (limitClosed(true) ? TELEMETRY_LIMIT_HIGH : 0);
+    };
+    if(backend != nullptr)
+    {
+        StepStamp stamp;
+        if(backend->popStamp(stamp))
+        {
+            uint8_t stampLimits = limits();
+            do
+            {
+                uint32_t interval = stamp.event & STEP_EVENT_INTERVAL_MASK;
+                float stampSpeed = interval > 0 ? ((stamp.event & STEP_EVENT_FORWARD) ? 1000000.0f : -1000000.0f) / interval : 0;
+                telemetry->record(stamp.micros, stamp.position, stampSpeed, (char)STEPPER_QUEUED, stampLimits);
+                telemetryPosition = stamp.position;
+            } while(backend->popStamp(stamp));
+        }
+    }
+    if(mode == STEPPER_QUEUED)
+        return;
+
+    long position = currentPosition();
+    if(position == telemetryPosition)
+        return;
+    telemetryPosition = position;
+    telemetry->record(micros(), position, speed(), (char)mode, limits());
+}
+#endif
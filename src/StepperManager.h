@@ -5,12 +5,23 @@
 #ifndef ROBOTOPO_STEPPERMANAGER_H
 #define ROBOTOPO_STEPPERMANAGER_H
 #include <AccelStepper.h>
+#include "StepProfile.h"
+#include "StepTimerBackend.h"
+#include "SpscQueue.h"
+#include "LimitSwitch.h"
+#include "StepperTelemetry.h"
+
+#define STEPPER_COMMAND_QUEUE_SIZE 16
 
 typedef enum StepperMode
 {
     STEPPER_NONE = 'n',
     STEPPER_MOVE_TO = 't',
     STEPPER_MOVE_SPEED = 's',
+    STEPPER_DIRECT = 'd', // something else (StepperGroup) is calling stepOnce()
+    STEPPER_PROFILE = 'p', // stepping off a StepProfile table
+    STEPPER_QUEUED = 'q', // StepTimerBackend's ISR is stepping, run() keeps its queue full
+    STEPPER_HOMING = 'h',
 } StepperMode;
 
 typedef enum LimitMode
@@ -20,6 +31,58 @@ typedef enum LimitMode
     LIMIT_LOW,
 } LimitMode;
 
+typedef enum StepperCommandType
+{
+    STEPPER_COMMAND_MOVE_TO,          // position, speed if > 0
+    STEPPER_COMMAND_MOVE_RELATIVE,    // position, speed if > 0
+    STEPPER_COMMAND_MOVE_SPEED,       // speed
+    STEPPER_COMMAND_STOP,
+    STEPPER_COMMAND_SOFT_STOP,
+    STEPPER_COMMAND_SET_MAX_SPEED,    // speed
+    STEPPER_COMMAND_SET_ACCELERATION, // speed is the acceleration
+    STEPPER_COMMAND_SET_POSITION,     // position
+} StepperCommandType;
+
+typedef struct StepperCommand
+{
+    StepperCommandType type;
+    long position;
+    float speed;
+} StepperCommand;
+
+typedef enum HomingState
+{
+    HOMING_IDLE,
+    HOMING_FAST_SEEK,  // towards the switch at fastSpeed
+    HOMING_BACKOFF,    // off it again by backoffSteps, and until it reads open
+    HOMING_SLOW_SEEK,  // back onto it at slowSpeed, this is the accurate hit
+    HOMING_OFFSET,     // offsetSteps off the switch, that spot becomes homePosition
+    HOMING_DONE,
+    HOMING_FAILED,     // maxTravel without a hit, couldn't get off the switch, or hit the other limit
+} HomingState;
+
+typedef struct HomingConfig
+{
+    bool towardHigh;     // which limit is home
+    float fastSpeed;     // steps/s, always positive
+    float slowSpeed;
+    long backoffSteps;
+    long offsetSteps;
+    long homePosition;
+    long maxTravel;      // give up seeking after this many steps, 0 = never
+} HomingConfig;
+
+// AccelStepper keeps step() protected. Naming it through a subclass is the standard way to get at
+// it on a stepper something else constructed, and it's still the virtual call, so every wiring
+// (and any AccelStepper subclass) pulses the same as runSpeed() would.
+struct AccelStepperAccess : public AccelStepper
+{
+    static void stepTo(AccelStepper *stepper, long position)
+    {
+        (stepper->*&AccelStepperAccess::step)(position);
+    }
+};
+
 class StepperManager
 {
 
@@ -46,6 +109,119 @@ class StepperManager
         void moveRelative(long pos, float speed);
         void moveToAbsolute(long pos, float speed);
         void softStop();
+        StepperMode getMode() const {return mode;}
+        AccelStepper *getStepper() const {return stepper;}
+        // Cached limit switches, either or both. Take over from limitFunction/limitMode when set.
+        void setLimitSwitches(LimitSwitch *pLowLimit, LimitSwitch *pHighLimit);
+        LimitSwitch *getLowLimit() const {return lowLimit;}
+        LimitSwitch *getHighLimit() const {return highLimit;}
+        // True if the limit that way is closed, or for a switch has latched a hit since the
+        // last clearLimitLatch(). Call with the direction of travel, it drops the other side's latch.
+        bool limitBlocks(bool forward);
+        void clearLimitLatch(bool forward);
+        // Single steps for whoever owns the timing (StepperGroup), straight to AccelStepper's
+        // step() with no interval check. now is when the step went out, for speed().
+        void beginDirectStepping();
+        void stepOnce(bool forward);
+        void stepOnce(bool forward, uint32_t now);
+        void endDirectStepping();
+        // Moves timed off a precomputed StepProfile instead of AccelStepper's per step maths.
+        // The profile has its own speed/acceleration and can be shared by steppers that don't
+        // move at the same time.
+        void setProfile(StepProfile *pProfile) {profile = pProfile;}
+        StepProfile *getProfile() const {return profile;}
+        bool moveProfiled(long pos);
+        // Micros until run() is due to step, 0 if it already is, off the clocks kept here: the
+        // profile's, and the hold on AccelStepper's first step after direct stepping. UINT32_MAX
+        // otherwise, AccelStepper, the caller or the backend's timer has it.
+        uint32_t getMicrosToNextStep() const;
+        // Same profile, but the steps come from a StepTimerBackend's timer interrupt. run() only
+        // has to be called often enough to keep the backend's queue from running dry. The ISR
+        // checks the limit switches itself, a limitFunction is only ever checked by run().
+        void setBackend(StepTimerBackend *pBackend) {backend = pBackend;}
+        StepTimerBackend *getBackend() const {return backend;}
+        bool moveQueued(long pos);
+        // For another task/core to send commands to whoever is calling run(). One producer only,
+        // they're applied in order at the top of the next run(). False when the queue is full.
+        bool postCommand(StepperCommandType type, long position = 0, float speed = 0);
+        bool postMoveToAbsolute(long pos, float speed = 0) {return postCommand(STEPPER_COMMAND_MOVE_TO, pos, speed);}
+        bool postMoveRelative(long pos, float speed = 0) {return postCommand(STEPPER_COMMAND_MOVE_RELATIVE, pos, speed);}
+        bool postMoveAtSpeed(float speed) {return postCommand(STEPPER_COMMAND_MOVE_SPEED, 0, speed);}
+        bool postStop() {return postCommand(STEPPER_COMMAND_STOP);}
+        bool postSoftStop() {return postCommand(STEPPER_COMMAND_SOFT_STOP);}
+        unsigned long getCommandsApplied() const {return commandsApplied;}
+        // Homing off whichever limit (switch or limitFunction) config says, all done by run(), so
+        // several axes home at once by just running them all. stop() abandons it. False if
+        // nothing could ever report a limit that way, the seek would never end.
+        bool home(const HomingConfig &config);
+        HomingState getHomingState() const {return homingState;}
+        bool isHoming() const {return mode == STEPPER_HOMING;}
+        // A sample per step into telemetry, only with FIRMWORK_TELEMETRY. Queued moves are
+        // sampled by the backend's ISR, with the real step times.
+#if FIRMWORK_TELEMETRY
+        void setTelemetry(StepperTelemetry *pTelemetry) {telemetry = pTelemetry;}
+#else
+        void setTelemetry(StepperTelemetry *) {}
+#endif
+    private:
+        float savedMaxSpeed = 0;
+        // DIRECT/PROFILE own the position, AccelStepper gets it back in endDirectStepping()
+        long directPosition = 0;
+        bool directForward = true;
+        uint32_t directLastStep = 0;
+        uint32_t directInterval = 0;
+        // AccelStepper's last step time is stale after direct stepping, it'd step straight away
+        bool handoffPending = false;
+        uint32_t handoffStep = 0;
+        uint32_t handoffWait() const;
+        void setDirectDirection(bool forward);
+        void stepDirect(bool forward)
+        {
+            if(forward != directForward)
+                setDirectDirection(forward);
+            directPosition += forward ? 1 : -1;
+            AccelStepperAccess::stepTo(stepper, directPosition);
+        }
+        StepProfile *profile = nullptr;
+        long profileTarget = 0;
+        bool profileForward = true;
+        uint32_t profileInterval = 0;
+        uint32_t profileLastStep = 0;
+        void runProfile();
+        StepTimerBackend *backend = nullptr;
+        LimitSwitch *lowLimit = nullptr;
+        LimitSwitch *highLimit = nullptr;
+        int8_t runDirection();
+        bool runMotion(bool overrideLimits);
+#if FIRMWORK_TELEMETRY
+        StepperTelemetry *telemetry = nullptr;
+        long telemetryPosition = 0;
+        void recordTelemetry();
+#endif
+        HomingConfig homing = {};
+        HomingState homingState = HOMING_IDLE;
+        long homingStart = 0;
+        bool homingRetried = false;
+        void runHoming();
+        void homingMove(long steps, float speed);
+        void homingSeek(float speed);
+        void endHoming(HomingState state);
+        bool limitClosed(bool forward);
+        bool hasLimit(bool forward) const;
+        void limitStop(bool forward);
+        // Any limit closed or latched at all, direction doesn't matter yet. Switches are just flags.
+        bool anyLimitActive()
+        {
+            if(lowLimit != nullptr || highLimit != nullptr)
+                return (lowLimit != nullptr && (lowLimit->isActive() || lowLimit->wasTriggered())) ||
+                       (highLimit != nullptr && (highLimit->isActive() || highLimit->wasTriggered()));
+            return limitFunction != nullptr && limitFunction();
+        }
+        void runQueued();
+        void endQueued();
+        SpscQueue<StepperCommand, STEPPER_COMMAND_QUEUE_SIZE> commands;
+        unsigned long commandsApplied = 0;
+        void applyCommand(const StepperCommand &command);
 };
 
 
@@ -0,0 +1,57 @@
+//
+// Created by Andrew Simmons on 10/15/26.
+//
+
+#include "StepperTelemetry.h"
+
+static const char csvHeader[] = "micros,position,speed,mode,limit_low,limit_high\n";
+
+// One sample as a CSV line, newline included. Returns snprintf's length.
+static int formatCsvLine(const TelemetrySample &sample, char *buffer, size_t size)
+{
+    return snprintf(buffer, size, "%lu,%ld,%.2f,%c,%d,%d\n", (unsigned long)sample.micros, (long)sample.position,
+                    sample.speed, sample.mode, (sample.limits & TELEMETRY_LIMIT_LOW) != 0,
+                    (sample.limits & TELEMETRY_LIMIT_HIGH) != 0);
+}
+
+const TelemetrySample &StepperTelemetry::get(size_t index) const
+{
+    size_t count = getCount();
+    size_t oldest = (head + TELEMETRY_BUFFER_SIZE - count) % TELEMETRY_BUFFER_SIZE;
+    return samples[(oldest + index) % TELEMETRY_BUFFER_SIZE];
+}
+
+void StepperTelemetry::clear()
+{
+    head = 0;
+    total = 0;
+    skipped = 0;
+}
+
+void StepperTelemetry::printCsv()
+{
+    char line[64];
+    Serial.print(csvHeader);
+    for(size_t i = 0; i < getCount(); i++)
+    {
+        formatCsvLine(get(i), line, sizeof(line));
+        Serial.print(line);
+    }
+}
+
+#if !defined(ESP_PLATFORM)
+bool StepperTelemetry::writeCsv(const char *path)
+{
+    FILE *file = fopen(path, "w");
+    if(file == nullptr)
+        return false;
+    char line[64];
+    fputs(csvHeader, file);
+    for(size_t i = 0; i < getCount(); i++)
+    {
+        formatCsvLine(get(i), line, sizeof(line));
+        fputs(line, file);
+    }
+    return fclose(file) == 0;
+}
+#endif
@@ -0,0 +1,70 @@
+//
+// Created by Andrew Simmons on 10/15/26.
+//
+
+#ifndef FIRMWORK_STEPPERTELEMETRY_H
+#define FIRMWORK_STEPPERTELEMETRY_H
+#include <Arduino.h>
+
+// Off unless the build turns it on (FIRMWORK_TELEMETRY=1 in platformio.ini's build_flags). Off,
+// StepperManager has no telemetry code or members at all, setTelemetry() is an empty inline.
+// It changes class layouts, so it has to be the same for every file: build flags only.
+#if !defined(FIRMWORK_TELEMETRY)
+#define FIRMWORK_TELEMETRY 0
+#endif
+
+#define TELEMETRY_BUFFER_SIZE 1024
+#define TELEMETRY_LIMIT_LOW 0x01
+#define TELEMETRY_LIMIT_HIGH 0x02
+
+typedef struct TelemetrySample
+{
+    uint32_t micros;
+    int32_t position;
+    float speed;     // steps/s
+    char mode;       // StepperMode
+    uint8_t limits;  // TELEMETRY_LIMIT_*
+} TelemetrySample;
+
+// Ring of the last TELEMETRY_BUFFER_SIZE samples, oldest overwritten. StepperManager records one
+// per step (every decimation'th step), so the timestamps give the real step timing to plot
+// velocity profiles and jitter from.
+class StepperTelemetry
+{
+    public:
+        void setDecimation(uint16_t every) {decimation = every > 0 ? every : 1;}
+        void record(uint32_t micros, long position, float speed, char mode, uint8_t limits)
+        {
+            if(++skipped < decimation)
+                return;
+            skipped = 0;
+            TelemetrySample *sample = &samples[head];
+            sample->micros = micros;
+            sample->position = position;
+            sample->speed = speed;
+            sample->mode = mode;
+            sample->limits = limits;
+            head = (head + 1) % TELEMETRY_BUFFER_SIZE;
+            total++;
+        }
+        size_t getCount() const {return total < TELEMETRY_BUFFER_SIZE ? total : TELEMETRY_BUFFER_SIZE;}
+        // Recorded, including ones since overwritten
+        unsigned long getTotal() const {return total;}
+        // 0 is the oldest still in the buffer
+        const TelemetrySample &get(size_t index) const;
+        void clear();
+        // micros,position,speed,mode,limit_low,limit_high, one line per sample, oldest first
+        void printCsv();
+#if !defined(ESP_PLATFORM)
+        bool writeCsv(const char *path);
+#endif
+    private:
+        TelemetrySample samples[TELEMETRY_BUFFER_SIZE];
+        size_t head = 0;
+        unsigned long total = 0;
+        uint16_t decimation = 1;
+        uint16_t skipped = 0;
+};
+
+
+#endif //FIRMWORK_STEPPERTELEMETRY_H
@@ -3,52 +3,192 @@
 //
 
 #include "Timer.h"
+#include "TimerScheduler.h"
 
+Timer::~Timer()
+{
+    if(scheduler != nullptr)
+        scheduler->remove(this);
+    if(expiredFrom != nullptr)
+        expiredFrom->unpark(this);
+}
 
 unsigned long long int Timer::getLastTriggerMSec() const
 {
-    return lastTriggerMSec;
+    return TimerDuration::fromTicks(lastTriggerTicks, clock).toMillis();
 }
 
 void Timer::setLastTriggerMSec(unsigned long long int pLastTriggerMSec)
 {
-    Timer::lastTriggerMSec = pLastTriggerMSec;
+    setLastTriggerTicks(TimerDuration::fromMillis(pLastTriggerMSec).toTicks(clock));
+}
+
+void Timer::setLastTriggerTicks(unsigned long long int pLastTriggerTicks)
+{
+    Timer::lastTriggerTicks = pLastTriggerTicks;
+    phaseSet = true;
+    if(scheduler != nullptr)
+    {
+        scheduler->restagger(this);
+        scheduler->reschedule(this);
+    }
 }
 
 unsigned long long int Timer::getDelayMSec() const
 {
-    return delayMSec;
+    return getDelay().toMillis();
 }
 
 void Timer::setDelayMSec(unsigned long long int pDelayMSec)
 {
-    Timer::delayMSec = pDelayMSec;
+    setDelay(TimerDuration::fromMillis(pDelayMSec));
+}
+
+TimerDuration Timer::getDelay() const
+{
+    return TimerDuration::fromTicks(delayTicks, clock);
+}
+
+void Timer::setDelay(TimerDuration delay)
+{
+    Timer::delayTicks = delay.toTicks(clock);
+    if(scheduler != nullptr)
+    {
+        scheduler->restagger(this);
+        scheduler->reschedule(this);
+    }
 }
 
 
 // Method sig be like:
 // void onTakeSonarReading(unsigned long long triggerCount, Timer *timer)
-void Timer::setTriggerFunction(void (*pTriggerFunction)(unsigned long long, Timer *))
+void Timer::setTriggerFunction(const TimerCallback &pTriggerFunction)
 {
     Timer::triggerFunction = pTriggerFunction;
 }
 
+void Timer::setTriggerFunction(void (*pTriggerFunction)(void *, unsigned long long, Timer *), void *context)
+{
+    if(pTriggerFunction == nullptr)
+    {
+        Timer::triggerFunction = nullptr;
+        return;
+    }
+    Timer::triggerFunction = [pTriggerFunction, context](unsigned long long count, Timer *timer) {
+        pTriggerFunction(context, count, timer);
+    };
+}
+
 bool Timer::update()
 {
-    unsigned long now = millis();
-    unsigned long long elapsed = now - this->lastTriggerMSec;
-    if(elapsed > delayMSec)
+    return update(clock->now());
+}
+
+bool Timer::update(unsigned long long now)
+{
+    if(rateMode == TIMER_FIXED_RATE)
+        return updateFixedRate(now);
+
+    // Signed, startAfter() can leave the last trigger in the future
+    long long elapsed = (long long)(now - this->lastTriggerTicks);
+    if(elapsed > (long long)delayTicks)
     {
-        this->lastTriggerMSec = now;
-        if(enabled)
-        {
-            triggerFunction(triggerCount++, this);
-        }
+        noteLate(now, lastTriggerTicks + delayTicks + 1);
+        this->lastTriggerTicks = now;
+        phaseSet = true;
+        fire();
         return true;
     }
     return false;
 }
 
+// Otherwise the first poll after an hour up would be an hour of missed periods
+void Timer::seedPhase(unsigned long long now)
+{
+    if(phaseSet || rateMode != TIMER_FIXED_RATE)
+        return;
+    lastTriggerTicks = now;
+    phaseSet = true;
+}
+
+bool Timer::updateFixedRate(unsigned long long now)
+{
+    if(!phaseSet)
+    {
+        seedPhase(now);
+        return false;
+    }
+    unsigned long long deadline = lastTriggerTicks + delayTicks;
+    if(now < deadline)
+        return false;
+
+    // Only pay for the divide when we're a whole period or more behind
+    unsigned long long late = now - deadline;
+    missedCount = (delayTicks > 0 && late >= delayTicks) ? late / delayTicks : 0;
+    noteLate(now, deadline);
+
+    if(delayTicks == 0)
+    {
+        lastTriggerTicks = now;
+        fire();
+    }
+    else if(catchUp == TIMER_CATCHUP_BURST)
+    {
+        unsigned long long periods = missedCount + 1;
+        unsigned long long calls = periods < TIMER_BURST_LIMIT ? periods : TIMER_BURST_LIMIT;
+        unsigned long long last = deadline + missedCount * delayTicks;
+        for(unsigned long long i = 0; i < calls && rateMode == TIMER_FIXED_RATE && enabled; i++)
+        {
+            lastTriggerTicks += delayTicks;
+            fire();
+        }
+        // Whatever the limit or an expiry cut short is dropped, same as TIMER_CATCHUP_SKIP
+        if(rateMode == TIMER_FIXED_RATE && lastTriggerTicks < last)
+            lastTriggerTicks = last;
+    }
+    else
+    {
+        lastTriggerTicks = deadline + missedCount * delayTicks;
+        if(catchUp == TIMER_CATCHUP_COALESCE && enabled)
+            triggerCount += missedCount;
+        fire();
+    }
+    return true;
+}
+
+void Timer::fire()
+{
+    if(enabled && triggerFunction)
+    {
+#if FIRMWORK_TIMER_STATS
+        uint32_t start = micros();
+#endif
+        triggerFunction(triggerCount++, this);
+#if FIRMWORK_TIMER_STATS
+        if(latePending)
+            stats.record(pendingLate, delayTicks, (uint32_t)((uint32_t)micros() - start));
+        latePending = false;
+#endif
+        if(repeatLimit != 0 && remaining > 0 && --remaining == 0)
+            expire();
+    }
+}
+
+void Timer::expire()
+{
+    enabled = false;
+    if(scheduler != nullptr)
+        scheduler->park(this);
+}
+
+// First time update() will fire, matches the checks above
+unsigned long long int Timer::getNextTriggerTicks() const
+{
+    if(rateMode == TIMER_FIXED_RATE)
+        return lastTriggerTicks + delayTicks;
+    return lastTriggerTicks + delayTicks + 1;
+}
+
 unsigned long long int Timer::getTriggerCount() const
 {
     return triggerCount;
@@ -64,7 +204,52 @@ boolean Timer::getEnabled() const
     return enabled;
 }
 
+// Just enabling an expired timer would fire it forever, remaining is already spent
 void Timer::setEnabled(boolean pEnabled)
 {
+    if(pEnabled && (isExpired() || expiredFrom != nullptr))
+    {
+        restart();
+        return;
+    }
     Timer::enabled = pEnabled;
 }
+
+void Timer::restart()
+{
+    if(isExpired())
+    {
+        remaining = repeatLimit;
+        enabled = true;
+    }
+    setLastTriggerTicks(clock->now());
+    if(expiredFrom != nullptr)
+        expiredFrom->add(this);
+}
+
+void Timer::setRepeat(unsigned long long count)
+{
+    repeatLimit = count;
+    remaining = count;
+}
+
+// The last trigger goes where it has to for the next one to land offset from now. Unsigned
+// maths wraps it back round if that's before tick 0.
+void Timer::startAfter(TimerDuration offset)
+{
+    unsigned long long start = clock->now() + offset.toTicks(clock);
+    setLastTriggerTicks(rateMode == TIMER_FIXED_RATE ? start - delayTicks : start - delayTicks - 1);
+}
+
+void Timer::setRateMode(TimerRateMode pRateMode, TimerCatchUp pCatchUp)
+{
+    Timer::rateMode = pRateMode;
+    Timer::catchUp = pCatchUp;
+    missedCount = 0;
+    if(scheduler != nullptr)
+    {
+        seedPhase(clock->now());
+        scheduler->restagger(this);
+        scheduler->reschedule(this);
+    }
+}
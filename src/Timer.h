@@ -5,33 +5,156 @@
 #ifndef ICEMAKERHACK_TIMER_H
 #define ICEMAKERHACK_TIMER_H
 #include <Arduino.h>
+#include "TimerClock.h"
+#include "InlineFunction.h"
+#include "TimerStats.h"
+
+class TimerScheduler;
+class Timer;
+
+// Most calls one TIMER_CATCHUP_BURST update() makes, periods missed beyond that are dropped
+#ifndef TIMER_BURST_LIMIT
+#define TIMER_BURST_LIMIT 16
+#endif
+
+// Room for a lambda capturing this plus one more pointer/value, or a function pointer and context
+#ifndef TIMER_CALLBACK_SIZE
+#define TIMER_CALLBACK_SIZE (2 * sizeof(void *))
+#endif
+
+typedef InlineFunction<void(unsigned long long, Timer *), TIMER_CALLBACK_SIZE> TimerCallback;
+
+typedef enum TimerRateMode
+{
+    TIMER_FIXED_DELAY, // next trigger is delay after we actually ran, late polls push it back
+    TIMER_FIXED_RATE,  // next trigger is delay after the previous deadline, keeps phase
+} TimerRateMode;
+
+// What a fixed rate timer does when it finds it's missed whole periods
+typedef enum TimerCatchUp
+{
+    TIMER_CATCHUP_SKIP,     // one call, missed periods are dropped
+    TIMER_CATCHUP_BURST,    // one call per missed period, back to back
+    TIMER_CATCHUP_COALESCE, // one call, triggerCount jumps by the missed periods
+} TimerCatchUp;
 
 class Timer
 {
+    friend class TimerScheduler;
     public:
         explicit Timer(unsigned long long int delay)
         {
-            this->delayMSec = delay;
+            this->delayTicks = delay;
         }
+        Timer(TimerDuration delay, const TimerClock *pClock)
+        {
+            this->clock = pClock;
+            this->delayTicks = delay.toTicks(pClock);
+        }
+        ~Timer();
+        // The wheel links are intrusive, a copy would share this one's place on the scheduler
+        Timer(const Timer &) = delete;
+        Timer &operator=(const Timer &) = delete;
 
         unsigned long long int getLastTriggerMSec() const;
         void setLastTriggerMSec(unsigned long long int lastTriggerMSec);
         unsigned long long int getDelayMSec() const;
         void setDelayMSec(unsigned long long int pDelayMSec);
-        void setTriggerFunction(void (*triggerFunction)(unsigned long long, Timer *));
-        void (*getTriggerFunction())(unsigned long long, Timer*) {return triggerFunction;}
+        TimerDuration getDelay() const;
+        void setDelay(TimerDuration delay);
+        const TimerClock *getClock() const {return clock;}
+        // Raw clock ticks, what update(now) and the scheduler work in
+        unsigned long long int getDelayTicks() const {return delayTicks;}
+        unsigned long long int getLastTriggerTicks() const {return lastTriggerTicks;}
+        void setLastTriggerTicks(unsigned long long int pLastTriggerTicks);
+        // Plain function pointer or a capturing lambda, [this](unsigned long long count, Timer *t) {...}
+        void setTriggerFunction(const TimerCallback &pTriggerFunction);
+        // For C style callbacks that want their owner back without a global
+        void setTriggerFunction(void (*pTriggerFunction)(void *, unsigned long long, Timer *), void *context);
+        // The plain function pointer it was given, nullptr for a lambda or the context overload
+        void (*getTriggerFunction() const)(unsigned long long, Timer *)
+        {
+            void (**function)(unsigned long long, Timer *) = triggerFunction.target<void (*)(unsigned long long, Timer *)>();
+            return function != nullptr ? *function : nullptr;
+        }
+        // Whatever it was given, lambdas included
+        const TimerCallback &getTriggerCallback() const {return triggerFunction;}
         bool update();
+        bool update(unsigned long long now);
+        unsigned long long int getNextTriggerTicks() const;
         unsigned long long int getTriggerCount() const;
         void setTriggerCount(unsigned long long int triggerCount);
         boolean getEnabled() const;
         void setEnabled(boolean enabled);
+        void restart();
+        // Fixed rate keeps phase with the last trigger. One that has never triggered or been
+        // restart()ed takes its phase from the first add() or update(), not from tick 0.
+        void setRateMode(TimerRateMode pRateMode, TimerCatchUp pCatchUp = TIMER_CATCHUP_SKIP);
+        TimerRateMode getRateMode() const {return rateMode;}
+        TimerCatchUp getCatchUp() const {return catchUp;}
+        // Fire count calls then expire: disabled and taken off its scheduler. 0 is forever (default).
+        // restart() or setEnabled(true) re-arms an expired timer and puts it back on the scheduler
+        // it expired off, unless that's been told to remove() it since.
+        void setRepeat(unsigned long long count);
+        void setOneShot() {setRepeat(1);}
+        unsigned long long getRepeat() const {return repeatLimit;}
+        unsigned long long getRemaining() const {return remaining;}
+        bool isExpired() const {return repeatLimit != 0 && remaining == 0;}
+        // First trigger offset from now instead of delay from now, then every delay as usual
+        void startAfter(TimerDuration offset);
+        // Whole periods missed going into the current/last trigger, fixed rate only
+        unsigned long long int getMissedCount() const {return missedCount;}
+        TimerScheduler *getScheduler() const {return scheduler;}
+#if FIRMWORK_TIMER_STATS
+        // Lateness of each on-schedule trigger and its callback time. Burst catch-up calls
+        // after the first aren't scheduled triggers, so they aren't counted.
+        const TimerStats &getStats() const {return stats;}
+        void clearStats() {stats.clear();}
+#endif
     private:
-        unsigned long long lastTriggerMSec = 0;
-        unsigned long long delayMSec = 0;
-        void (*triggerFunction)(unsigned long long, Timer*);
+        const TimerClock *clock = &MillisClock;
+        unsigned long long lastTriggerTicks = 0;
+        bool phaseSet = false; // lastTriggerTicks is a real trigger or was set, not just 0
+        unsigned long long delayTicks = 0;
+        TimerCallback triggerFunction;
         unsigned long long triggerCount = 0;
         boolean enabled = true;
+        TimerRateMode rateMode = TIMER_FIXED_DELAY;
+        TimerCatchUp catchUp = TIMER_CATCHUP_SKIP;
+        unsigned long long missedCount = 0;
+        unsigned long long repeatLimit = 0;
+        unsigned long long remaining = 0;
+        bool updateFixedRate(unsigned long long now);
+        void seedPhase(unsigned long long now);
+#if FIRMWORK_TIMER_STATS
+        TimerStats stats;
+        unsigned long long pendingLate = 0;
+        bool latePending = false;
+        void noteLate(unsigned long long now, unsigned long long deadline)
+        {
+            pendingLate = now - deadline;
+            latePending = true;
+        }
+#else
+        void noteLate(unsigned long long, unsigned long long) {}
+#endif
+        void fire();
+        void expire();
+
+        // Wheel bookkeeping, owned by TimerScheduler. Intrusive so add/remove never allocate.
+        TimerScheduler *scheduler = nullptr;
+        // Expired off this one, parked on its list (wheel links) until restart()
+        TimerScheduler *expiredFrom = nullptr;
+        Timer *wheelNext = nullptr;
+        Timer *wheelPrev = nullptr;
+        unsigned long long wheelExpires = 0;
+        byte wheelLevel = 0;
+        byte wheelSlot = 0;
+        bool wheelQueued = false;
+        // Slots charged by a staggering scheduler, stride 0 when it hasn't
+        uint16_t staggerSlot = 0;
+        uint16_t staggerStride = 0;
 };
 
 
-#endif //ICEMAKERHACK_TIMER_H
\ No newline at end of file
+#endif //ICEMAKERHACK_TIMER_H
@@ -0,0 +1,107 @@
+//
+// Created by Andrew Simmons on 10/15/26.
+//
+
+#include "TimerClock.h"
+#if defined(ESP_PLATFORM)
+#include <esp_timer.h>
+#endif
+
+#if defined(ESP_PLATFORM)
+static portMUX_TYPE wrapMux = portMUX_INITIALIZER_UNLOCKED;
+#define WRAP_LOCK() portENTER_CRITICAL_SAFE(&wrapMux)
+#define WRAP_UNLOCK() portEXIT_CRITICAL_SAFE(&wrapMux)
+#else
+#define WRAP_LOCK() noInterrupts()
+#define WRAP_UNLOCK() interrupts()
+#endif
+
+typedef struct WrapState { uint32_t last, high; } WrapState;
+
+// Read and extend under the lock, otherwise a second caller could see the wrap and
+// bump high between our read and our compare
+static unsigned long long extendWrap(uint32_t (*read)(), WrapState *state)
+{
+    WRAP_LOCK();
+    uint32_t now = read();
+    if(now < state->last)
+        state->high++;
+    state->last = now;
+    unsigned long long extended = ((unsigned long long)state->high << 32) | now;
+    WRAP_UNLOCK();
+    return extended;
+}
+
+// Force 32 bits, unsigned long is 64 on the host
+static uint32_t millis32()
+{
+    return (uint32_t)millis();
+}
+
+static uint32_t micros32()
+{
+    return (uint32_t)micros();
+}
+
+static WrapState millisWrap = {0, 0};
+static WrapState microsWrap = {0, 0};
+
+unsigned long long millis64()
+{
+    return extendWrap(millis32, &millisWrap);
+}
+
+unsigned long long micros64()
+{
+    return extendWrap(micros32, &microsWrap);
+}
+
+const TimerClock MillisClock = {millis64, 1000UL};
+const TimerClock MicrosClock = {micros64, 1000000UL};
+
+#if defined(ESP_PLATFORM)
+static unsigned long long espTimerNow()
+{
+    return (unsigned long long)esp_timer_get_time();
+}
+
+const TimerClock EspTimerClock = {espTimerNow, 1000000UL};
+#endif
+
+unsigned long long FakeClock::micros = 0;
+
+unsigned long long FakeClock::now()
+{
+    return micros;
+}
+
+void FakeClock::set(unsigned long long pMicros)
+{
+    FakeClock::micros = pMicros;
+}
+
+void FakeClock::advance(unsigned long long pMicros)
+{
+    FakeClock::micros += pMicros;
+}
+
+const TimerClock FakeTimerClock = {FakeClock::now, 1000000UL};
+
+// Conversions only happen when a delay is set/read, never per update()
+TimerDuration TimerDuration::fromTicks(unsigned long long ticks, const TimerClock *clock)
+{
+    if(clock->ticksPerSecond == 1000000UL)
+        return TimerDuration(ticks);
+    if(1000000UL % clock->ticksPerSecond == 0)
+        return TimerDuration(ticks * (1000000UL / clock->ticksPerSecond));
+    return TimerDuration(ticks * 1000000ULL / clock->ticksPerSecond);
+}
+
+unsigned long long TimerDuration::toTicks(const TimerClock *clock) const
+{
+    if(clock->ticksPerSecond == 1000000UL)
+        return micros;
+    if(1000000UL % clock->ticksPerSecond == 0)
+        return micros / (1000000UL / clock->ticksPerSecond);
+    return micros * clock->ticksPerSecond / 1000000ULL;
+}
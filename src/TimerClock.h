@@ -0,0 +1,57 @@
+//
+// Created by Andrew Simmons on 10/15/26.
+//
+
+#ifndef FIRMWORK_TIMERCLOCK_H
+#define FIRMWORK_TIMERCLOCK_H
+#include <Arduino.h>
+
+// A time source for Timer/TimerScheduler. now() is in the clock's own ticks so the
+// hot path never converts, durations get turned into ticks once when they're set.
+typedef struct TimerClock
+{
+    unsigned long long (*now)();
+    unsigned long ticksPerSecond;
+} TimerClock;
+
+// millis()/micros() extended past their 32 bit wrap (49.7 days / 71.6 minutes). Safe from
+// any task or ISR, just has to get called at least once per wrap period, which anything
+// polling a Timer does.
+unsigned long long millis64();
+unsigned long long micros64();
+
+extern const TimerClock MillisClock;
+extern const TimerClock MicrosClock;
+#if defined(ESP_PLATFORM)
+extern const TimerClock EspTimerClock; // esp_timer_get_time(), 64 bit micros
+#endif
+extern const TimerClock FakeTimerClock; // micros, only moves when FakeClock says so
+
+class FakeClock
+{
+    public:
+        static unsigned long long now();
+        static void set(unsigned long long pMicros);
+        static void advance(unsigned long long pMicros);
+    private:
+        static unsigned long long micros;
+};
+
+// Strong duration type so ms vs us can't get mixed up, stored as micros
+class TimerDuration
+{
+    public:
+        static TimerDuration fromMicros(unsigned long long us) {return TimerDuration(us);}
+        static TimerDuration fromMillis(unsigned long long ms) {return TimerDuration(ms * 1000ULL);}
+        static TimerDuration fromSeconds(unsigned long long s) {return TimerDuration(s * 1000000ULL);}
+        static TimerDuration fromTicks(unsigned long long ticks, const TimerClock *clock);
+        unsigned long long toMicros() const {return micros;}
+        unsigned long long toMillis() const {return micros / 1000ULL;}
+        unsigned long long toTicks(const TimerClock *clock) const;
+    private:
+        explicit TimerDuration(unsigned long long us) : micros(us) {}
+        unsigned long long micros;
+};
+
+
+#endif //FIRMWORK_TIMERCLOCK_H
@@ -0,0 +1,137 @@
+//
+// Created by Andrew Simmons on 10/15/26.
+//
+
+#ifndef FIRMWORK_TIMERPOOL_H
+#define FIRMWORK_TIMERPOOL_H
+#include <Arduino.h>
+#include <new>
+#include "Timer.h"
+#include "TimerScheduler.h"
+
+// One periodic job. Plain function pointer so a whole table can be constexpr and sit in flash:
+//   static constexpr TimerTask tasks[] = {
+//       {100, readSensors, true},
+//       {1000, reportStatus, true},
+//   };
+typedef struct TimerTask
+{
+    unsigned long long periodMSec;
+    void (*callback)(unsigned long long, Timer *);
+    bool enabled;
+} TimerTask;
+
+// N Timers in one block, handed out and taken back without touching the heap. Declare it
+// static/global and the whole lot is in .bss from boot. The point is no allocation and no
+// fragmentation, not speed: the scheduler still walks its wheel, not the pool.
+template<size_t N>
+class TimerPool
+{
+    public:
+        explicit TimerPool(const TimerClock *pClock = &MillisClock) : clock(pClock) {}
+        ~TimerPool()
+        {
+            for(size_t i = 0; i < N; i++)
+            {
+                if(used[i])
+                    slot(i)->~Timer();
+            }
+        }
+        TimerPool(const TimerPool &) = delete;
+        TimerPool &operator=(const TimerPool &) = delete;
+
+        // nullptr once all N are out
+        Timer *acquire(TimerDuration delay)
+        {
+            for(size_t i = 0; i < N; i++)
+            {
+                if(used[i])
+                    continue;
+                used[i] = true;
+                count++;
+                return new(storage[i]) Timer(delay, clock);
+            }
+            return nullptr;
+        }
+        Timer *acquire(const TimerTask &task)
+        {
+            Timer *timer = acquire(TimerDuration::fromMillis(task.periodMSec));
+            if(timer != nullptr)
+            {
+                timer->setTriggerFunction(task.callback);
+                timer->setEnabled(task.enabled);
+            }
+            return timer;
+        }
+        // Also takes it off its scheduler. Timers that aren't ours are ignored.
+        void release(Timer *timer)
+        {
+            size_t i = indexOf(timer);
+            if(i >= N || !used[i])
+                return;
+            timer->~Timer();
+            used[i] = false;
+            count--;
+        }
+
+        // A whole task table, in order, added to scheduler if there is one. Returns how many
+        // were made, short only if something else already has slots out.
+        template<size_t M>
+        size_t load(const TimerTask (&tasks)[M], TimerScheduler *scheduler = nullptr)
+        {
+            static_assert(M <= N, "TimerPool: task table is bigger than the pool");
+            return load(tasks, M, scheduler);
+        }
+        size_t load(const TimerTask *tasks, size_t taskCount, TimerScheduler *scheduler = nullptr)
+        {
+            size_t loaded = 0;
+            for(size_t t = 0; t < taskCount; t++)
+            {
+                Timer *timer = acquire(tasks[t]);
+                if(timer == nullptr)
+                    break;
+                if(scheduler != nullptr)
+                    scheduler->add(timer);
+                loaded++;
+            }
+            return loaded;
+        }
+
+        // Polls every live timer in storage order, for pools not on a scheduler
+        unsigned int update()
+        {
+            return update(clock->now());
+        }
+        unsigned int update(unsigned long long now)
+        {
+            unsigned int fired = 0;
+            for(size_t i = 0; i < N; i++)
+            {
+                if(used[i] && slot(i)->update(now))
+                    fired++;
+            }
+            return fired;
+        }
+
+        // nullptr for a free slot
+        Timer *get(size_t index) {return index < N && used[index] ? slot(index) : nullptr;}
+        size_t getCount() const {return count;}
+        static constexpr size_t capacity() {return N;}
+        const TimerClock *getClock() const {return clock;}
+    private:
+        alignas(Timer) unsigned char storage[N][sizeof(Timer)];
+        bool used[N] = {};
+        size_t count = 0;
+        const TimerClock *clock;
+        Timer *slot(size_t i) {return reinterpret_cast<Timer *>(storage[i]);}
+        size_t indexOf(const Timer *timer) const
+        {
+            const unsigned char *p = reinterpret_cast<const unsigned char *>(timer);
+            if(p < storage[0] || p >= storage[0] + sizeof(storage))
+                return N;
+            return (size_t)(p - storage[0]) / sizeof(Timer);
+        }
+};
+
+
+#endif //FIRMWORK_TIMERPOOL_H
@@ -0,0 +1,476 @@
+//
+// Created by Andrew Simmons on 10/15/26.
+//
+
+#include "TimerScheduler.h"
+
+TimerScheduler::TimerScheduler(const TimerClock *clock) : clock(clock)
+{
+    staggerSlotTicks = TimerDuration::fromMillis(TIMER_STAGGER_SLOT_MSEC).toTicks(clock);
+    if(staggerSlotTicks == 0)
+        staggerSlotTicks = 1;
+    for(unsigned int slot = 0; slot < TIMER_STAGGER_SLOTS; slot++)
+        slotLoad[slot] = 0;
+    for(byte level = 0; level < TIMER_WHEEL_LEVELS; level++)
+    {
+        occupied[level] = 0;
+        for(byte slot = 0; slot < TIMER_WHEEL_SLOTS; slot++)
+            wheel[level][slot] = nullptr;
+    }
+}
+
+// Let go of everything so timers outliving us don't call back into a dead scheduler
+TimerScheduler::~TimerScheduler()
+{
+    for(byte level = 0; level < TIMER_WHEEL_LEVELS; level++)
+    {
+        for(byte slot = 0; slot < TIMER_WHEEL_SLOTS; slot++)
+        {
+            while(wheel[level][slot] != nullptr)
+                remove(wheel[level][slot]);
+        }
+    }
+    while(expired != nullptr)
+        unpark(expired);
+}
+
+bool TimerScheduler::add(Timer *timer)
+{
+    if(timer->clock != clock)
+        return false;
+    if(timer->scheduler == this)
+        return true;
+    if(timer->scheduler != nullptr)
+        timer->scheduler->remove(timer);
+    if(timer->expiredFrom != nullptr)
+        timer->expiredFrom->unpark(timer);
+
+    if(!started)
+    {
+        currentTick = clock->now();
+        started = true;
+    }
+
+    timer->seedPhase(clock->now());
+    // Before it's ours, so startAfter() doesn't file it on the wheel early
+    if(stagger)
+        staggerTimer(timer);
+    timer->scheduler = this;
+    timerCount++;
+    insert(timer);
+    return true;
+}
+
+void TimerScheduler::remove(Timer *timer)
+{
+    if(timer->expiredFrom == this)
+        unpark(timer);
+    if(timer->scheduler != this)
+        return;
+    if(timer->wheelQueued)
+        unlink(timer);
+    timer->scheduler = nullptr;
+    timerCount--;
+    if(timer->staggerStride != 0)
+    {
+        chargeSlots(timer->staggerSlot, timer->staggerStride, -1);
+        timer->staggerStride = 0;
+    }
+}
+
+void TimerScheduler::park(Timer *timer)
+{
+    remove(timer);
+    timer->wheelPrev = nullptr;
+    timer->wheelNext = expired;
+    if(expired != nullptr)
+        expired->wheelPrev = timer;
+    expired = timer;
+    timer->expiredFrom = this;
+}
+
+void TimerScheduler::unpark(Timer *timer)
+{
+    if(timer->wheelPrev != nullptr)
+        timer->wheelPrev->wheelNext = timer->wheelNext;
+    else
+        expired = timer->wheelNext;
+    if(timer->wheelNext != nullptr)
+        timer->wheelNext->wheelPrev = timer->wheelPrev;
+    timer->wheelNext = nullptr;
+    timer->wheelPrev = nullptr;
+    timer->expiredFrom = nullptr;
+}
+
+void TimerScheduler::reschedule(Timer *timer)
+{
+    if(timer->scheduler != this)
+        return;
+    if(timer->wheelQueued)
+        unlink(timer);
+    insert(timer);
+}
+
+unsigned int TimerScheduler::update()
+{
+    return update(clock->now());
+}
+
+unsigned int TimerScheduler::update(unsigned long long now)
+{
+    if(timerCount == 0 || now < currentTick)
+    {
+        if(now > currentTick)
+            currentTick = now;
+        return 0;
+    }
+
+    unsigned int fired = 0;
+    while(currentTick <= now)
+    {
+        byte slot = currentTick & TIMER_WHEEL_MASK;
+        if(slot == 0)
+        {
+            // Pull the next chunk of each upper level down, highest level only when the one below wrapped
+            for(byte level = 1; level < TIMER_WHEEL_LEVELS; level++)
+            {
+                byte upperSlot = (currentTick >> (TIMER_WHEEL_BITS * level)) & TIMER_WHEEL_MASK;
+                cascade(level, upperSlot);
+                if(upperSlot != 0)
+                    break;
+            }
+        }
+
+        if(occupied[0] & (1ULL << slot))
+        {
+            fired += fireSlot(slot, now);
+            currentTick++;
+            continue;
+        }
+
+        // Skip straight to the next occupied slot. Upper level slots only start on a level 0 turn,
+        // so one later in this turn comes first. Otherwise cascading an empty slot does nothing,
+        // and a long idle gap is one hop to whichever level has something, not one per turn.
+        unsigned long long ahead = occupied[0] >> slot;
+        unsigned long long next = ahead != 0 ? currentTick + __builtin_ctzll(ahead) : nextOccupiedTick();
+        currentTick = next > now ? now + 1 : next;
+    }
+    return fired;
+}
+
+// First tick after currentTick that starts an occupied slot, on whichever level. Every level's
+// current slot has already been fired or cascaded, so anything left in it is a full turn out.
+unsigned long long TimerScheduler::nextOccupiedTick() const
+{
+    unsigned long long next = TIMER_NO_DEADLINE;
+    for(byte level = 0; level < TIMER_WHEEL_LEVELS; level++)
+    {
+        unsigned long long bits = occupied[level];
+        if(bits == 0)
+            continue;
+        byte shift = TIMER_WHEEL_BITS * level;
+        byte start = ((currentTick >> shift) + 1) & TIMER_WHEEL_MASK;
+        unsigned long long rotated = start == 0 ? bits : (bits >> start) | (bits << (TIMER_WHEEL_SLOTS - start));
+        unsigned long long turn = (currentTick >> (shift + TIMER_WHEEL_BITS)) << (shift + TIMER_WHEEL_BITS);
+        // Slot numbers past the end of this turn carry into the next one
+        unsigned long long index = ((currentTick >> shift) & TIMER_WHEEL_MASK) + 1 + __builtin_ctzll(rotated);
+        unsigned long long tick = turn + (index << shift);
+        if(tick < next)
+            next = tick;
+    }
+    return next;
+}
+
+unsigned int TimerScheduler::getTimerCount() const
+{
+    return timerCount;
+}
+
+unsigned long long TimerScheduler::getNextDeadline() const
+{
+    unsigned long long deadline = TIMER_NO_DEADLINE;
+    for(byte level = 0; level < TIMER_WHEEL_LEVELS; level++)
+    {
+        unsigned long long bits = occupied[level];
+        if(bits == 0)
+            continue;
+
+        // Start at the slot we're on. Upper levels cascade their current slot as soon as we
+        // step past the boundary, after that anything filed there is a full turn out.
+        byte start = (currentTick >> (TIMER_WHEEL_BITS * level)) & TIMER_WHEEL_MASK;
+        if(level > 0 && (currentTick & ((1ULL << (TIMER_WHEEL_BITS * level)) - 1)) != 0)
+            start = (start + 1) & TIMER_WHEEL_MASK;
+        unsigned long long rotated = start == 0 ? bits : (bits >> start) | (bits << (TIMER_WHEEL_SLOTS - start));
+        byte slot = (start + __builtin_ctzll(rotated)) & TIMER_WHEEL_MASK;
+
+        // Slots within a level are in time order, and each slot keeps its earliest at the head
+        if(wheel[level][slot]->wheelExpires < deadline)
+            deadline = wheel[level][slot]->wheelExpires;
+    }
+    return deadline;
+}
+
+unsigned long long TimerScheduler::idleUntilNextDeadline()
+{
+    unsigned long long deadline = getNextDeadline();
+    unsigned long long start = clock->now();
+    if(deadline == TIMER_NO_DEADLINE || deadline <= start)
+        return 0;
+
+    unsigned long long ticks = deadline - start;
+    if(idleFunction != nullptr)
+    {
+        idleFunction(ticks, clock);
+    }
+    else
+    {
+        unsigned long long ms = TimerDuration::fromTicks(ticks, clock).toMillis();
+        if(ms > 0)
+            delay(ms);
+    }
+
+    unsigned long long slept = clock->now() - start;
+    idleTicks += slept;
+    return slept;
+}
+
+void TimerScheduler::setIdleFunction(void (*pIdleFunction)(unsigned long long, const TimerClock *))
+{
+    TimerScheduler::idleFunction = pIdleFunction;
+}
+
+TimerDuration TimerScheduler::getIdleTime() const
+{
+    return TimerDuration::fromTicks(idleTicks, clock);
+}
+
+void TimerScheduler::resetIdleTime()
+{
+    idleTicks = 0;
+}
+
+void TimerScheduler::insert(Timer *timer)
+{
+    unsigned long long expires = timer->getNextTriggerTicks();
+    // Anything armed from inside a callback waits at least one tick, otherwise a timer
+    // re-arming itself in the past would spin the current slot forever
+    unsigned long long earliest = firing ? currentTick + 1 : currentTick;
+    if(expires < earliest)
+        expires = earliest;
+    timer->wheelExpires = expires;
+
+    unsigned long long delta = expires - currentTick;
+    byte level = 0;
+    while(level < TIMER_WHEEL_LEVELS - 1 && delta >= (1ULL << (TIMER_WHEEL_BITS * (level + 1))))
+        level++;
+
+    // Past the top of the wheel, park at the furthest slot, cascade() re-files it with the real expiry
+    unsigned long long maxDelta = (1ULL << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS)) - 1;
+    unsigned long long slotTime = delta > maxDelta ? currentTick + maxDelta : expires;
+    byte slot = (slotTime >> (TIMER_WHEEL_BITS * level)) & TIMER_WHEEL_MASK;
+
+    timer->wheelLevel = level;
+    timer->wheelSlot = slot;
+    // Head of the slot is always its earliest, so getNextDeadline() never walks a slot
+    Timer *head = wheel[level][slot];
+    if(head == nullptr || expires <= head->wheelExpires)
+    {
+        timer->wheelPrev = nullptr;
+        timer->wheelNext = head;
+        wheel[level][slot] = timer;
+    }
+    else
+    {
+        timer->wheelPrev = head;
+        timer->wheelNext = head->wheelNext;
+        head->wheelNext = timer;
+    }
+    if(timer->wheelNext != nullptr)
+        timer->wheelNext->wheelPrev = timer;
+    occupied[level] |= (1ULL << slot);
+    timer->wheelQueued = true;
+}
+
+void TimerScheduler::unlink(Timer *timer)
+{
+    byte level = timer->wheelLevel;
+    byte slot = timer->wheelSlot;
+    if(timer->wheelPrev != nullptr)
+        timer->wheelPrev->wheelNext = timer->wheelNext;
+    else
+        wheel[level][slot] = timer->wheelNext;
+    if(timer->wheelNext != nullptr)
+        timer->wheelNext->wheelPrev = timer->wheelPrev;
+    if(wheel[level][slot] == nullptr)
+        occupied[level] &= ~(1ULL << slot);
+    else if(timer->wheelPrev == nullptr && level > 0)
+        promoteEarliest(level, slot);
+
+    timer->wheelNext = nullptr;
+    timer->wheelPrev = nullptr;
+    timer->wheelQueued = false;
+}
+
+// The head just left an upper level slot, whose timers aren't all due together. Firing only
+// ever takes from level 0 where they are, so this walk is just for remove()/reschedule().
+void TimerScheduler::promoteEarliest(byte level, byte slot)
+{
+    Timer *head = wheel[level][slot];
+    Timer *earliest = head;
+    for(Timer *timer = head->wheelNext; timer != nullptr; timer = timer->wheelNext)
+    {
+        if(timer->wheelExpires < earliest->wheelExpires)
+            earliest = timer;
+    }
+    if(earliest == head)
+        return;
+    earliest->wheelPrev->wheelNext = earliest->wheelNext;
+    if(earliest->wheelNext != nullptr)
+        earliest->wheelNext->wheelPrev = earliest->wheelPrev;
+    earliest->wheelPrev = nullptr;
+    earliest->wheelNext = head;
+    head->wheelPrev = earliest;
+    wheel[level][slot] = earliest;
+}
+
+void TimerScheduler::cascade(byte level, byte slot)
+{
+    Timer *timer = wheel[level][slot];
+    wheel[level][slot] = nullptr;
+    occupied[level] &= ~(1ULL << slot);
+    while(timer != nullptr)
+    {
+        Timer *next = timer->wheelNext;
+        timer->wheelQueued = false;
+        insert(timer);
+        timer = next;
+    }
+}
+
+unsigned int TimerScheduler::fireSlot(byte slot, unsigned long long now)
+{
+    unsigned int fired = 0;
+    firing = true;
+    // Pop one at a time, callbacks are free to add/remove/reschedule anything
+    while(wheel[0][slot] != nullptr)
+    {
+        Timer *timer = wheel[0][slot];
+        unlink(timer);
+        if(timer->update(now))
+            fired++;
+        // Always re-file, a burst or a callback may have moved lastTriggerMSec after a reschedule
+        if(timer->scheduler == this)
+            reschedule(timer);
+    }
+    firing = false;
+    return fired;
+}
+
+// Tries every first slot within one period (or one window, if the period's longer) and keeps
+// the one whose busiest slot is least busy, ties to the quietest overall, then the soonest
+void TimerScheduler::staggerTimer(Timer *timer)
+{
+    // Fixed delay timers run a tick late every period, whatever slot they start in they
+    // drift back into step with everything else, so there's nothing to plan for them
+    if(timer->delayTicks == 0 || timer->rateMode != TIMER_FIXED_RATE)
+        return;
+    unsigned int stride = staggerStride(timer->delayTicks);
+    unsigned int hits = (TIMER_STAGGER_SLOTS + stride - 1) / stride;
+    unsigned long long now = clock->now();
+    unsigned int base = (now / staggerSlotTicks) % TIMER_STAGGER_SLOTS;
+
+    unsigned int best = 0;
+    unsigned int bestPeak = 0xFFFFFFFF;
+    unsigned int bestTotal = 0xFFFFFFFF;
+    for(unsigned int offset = 0; offset < stride; offset++)
+    {
+        unsigned int peak = 0;
+        unsigned int total = 0;
+        for(unsigned int k = 0; k < hits; k++)
+        {
+            unsigned int load = slotLoad[(base + offset + k * stride) % TIMER_STAGGER_SLOTS];
+            total += load;
+            if(load > peak)
+                peak = load;
+        }
+        if(peak < bestPeak || (peak == bestPeak && total < bestTotal))
+        {
+            best = offset;
+            bestPeak = peak;
+            bestTotal = total;
+        }
+    }
+
+    timer->staggerSlot = (base + best) % TIMER_STAGGER_SLOTS;
+    timer->staggerStride = stride;
+    chargeSlots(timer->staggerSlot, stride, 1);
+    // Land in the middle of the slot so a late poll or the fixed delay's extra tick stays in it
+    unsigned long long slotStart = (now / staggerSlotTicks + best) * staggerSlotTicks;
+    unsigned long long first = slotStart + staggerSlotTicks / 2;
+    timer->startAfter(TimerDuration::fromTicks(first > now ? first - now : 0, clock));
+}
+
+// A staggered timer's phase, period or rate mode changed under it (restart(), setDelay()...).
+// Its slot is wherever it triggers next now, only a fixed rate timer keeps one.
+void TimerScheduler::restagger(Timer *timer)
+{
+    if(timer->staggerStride == 0)
+        return;
+    chargeSlots(timer->staggerSlot, timer->staggerStride, -1);
+    timer->staggerStride = 0;
+    if(timer->delayTicks == 0 || timer->rateMode != TIMER_FIXED_RATE)
+        return;
+    timer->staggerSlot = (timer->getNextTriggerTicks() / staggerSlotTicks) % TIMER_STAGGER_SLOTS;
+    timer->staggerStride = staggerStride(timer->delayTicks);
+    chargeSlots(timer->staggerSlot, timer->staggerStride, 1);
+}
+
+// Slots between triggers, one window at most
+unsigned int TimerScheduler::staggerStride(unsigned long long delayTicks) const
+{
+    unsigned long long periodSlots = delayTicks / staggerSlotTicks;
+    return periodSlots == 0 ? 1 : (periodSlots > TIMER_STAGGER_SLOTS ? TIMER_STAGGER_SLOTS : (unsigned int)periodSlots);
+}
+
+void TimerScheduler::chargeSlots(unsigned int first, unsigned int stride, int amount)
+{
+    unsigned int hits = (TIMER_STAGGER_SLOTS + stride - 1) / stride;
+    for(unsigned int k = 0; k < hits; k++)
+        slotLoad[(first + k * stride) % TIMER_STAGGER_SLOTS] += amount;
+}
+
+unsigned int TimerScheduler::getMaxSlotLoad() const
+{
+    unsigned int peak = 0;
+    for(unsigned int slot = 0; slot < TIMER_STAGGER_SLOTS; slot++)
+    {
+        if(slotLoad[slot] > peak)
+            peak = slotLoad[slot];
+    }
+    return peak;
+}
+
+void TimerScheduler::printSlotLoad()
+{
+    Serial.printf("slot,start_ms,load\n");
+    for(unsigned int slot = 0; slot < TIMER_STAGGER_SLOTS; slot++)
+        Serial.printf("%u,%u,%u\n", slot, slot * TIMER_STAGGER_SLOT_MSEC, slotLoad[slot]);
+}
+
+#if FIRMWORK_TIMER_STATS
+void TimerScheduler::printStats()
+{
+    char label[48];
+    for(byte level = 0; level < TIMER_WHEEL_LEVELS; level++)
+    {
+        for(byte slot = 0; slot < TIMER_WHEEL_SLOTS; slot++)
+        {
+            for(Timer *timer = wheel[level][slot]; timer != nullptr; timer = timer->wheelNext)
+            {
+                snprintf(label, sizeof(label), "timer %p delay_ticks=%llu", (void *)timer, timer->delayTicks);
+                timer->getStats().print(label);
+            }
+        }
+    }
+}
+#endif
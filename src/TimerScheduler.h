@@ -0,0 +1,98 @@
+//
+// Created by Andrew Simmons on 10/15/26.
+//
+
+#ifndef FIRMWORK_TIMERSCHEDULER_H
+#define FIRMWORK_TIMERSCHEDULER_H
+#include <Arduino.h>
+#include "Timer.h"
+
+// 4 levels of 64 slots, level n slots are 64^n clock ticks wide. Covers ~4.6 hours on the
+// millis clock (~16s on micros) before timers get parked in the top level and re-cascaded.
+#define TIMER_WHEEL_BITS 6
+#define TIMER_WHEEL_SLOTS (1 << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_MASK (TIMER_WHEEL_SLOTS - 1)
+#define TIMER_WHEEL_LEVELS 4
+
+#define TIMER_NO_DEADLINE 0xFFFFFFFFFFFFFFFFULL
+
+// Staggering plans over a window of slots, 100 x 10ms = 1s is a multiple of all the usual
+// periods. Periods that don't divide the window are only approximately accounted for.
+#define TIMER_STAGGER_SLOTS 100
+#define TIMER_STAGGER_SLOT_MSEC 10
+
+// Owns a set of Timers in a hierarchical timing wheel so one update() only touches
+// timers that are actually due. Timers keep working as before (setDelayMSec,
+// setEnabled, trigger function), just don't call Timer::update() on them yourself.
+// Every timer has to run off the scheduler's clock.
+class TimerScheduler
+{
+    friend class Timer;
+    public:
+        explicit TimerScheduler(const TimerClock *clock = &MillisClock);
+        ~TimerScheduler();
+        bool add(Timer *timer);
+        void remove(Timer *timer);
+        void reschedule(Timer *timer);
+        unsigned int update();
+        unsigned int update(unsigned long long now);
+        unsigned int getTimerCount() const;
+        // Earliest tick any timer (disabled ones too) comes due, TIMER_NO_DEADLINE if empty.
+        // A bitmap scan and one slot head per level, no matter how many timers.
+        unsigned long long getNextDeadline() const;
+        // Hands the time until the next deadline to the idle function (light sleep, vTaskDelay,
+        // FakeClock::advance...) and returns the ticks actually spent there
+        unsigned long long idleUntilNextDeadline();
+        // Gets the ticks to idle for. Default is delay(), which is vTaskDelay on the ESP32.
+        void setIdleFunction(void (*pIdleFunction)(unsigned long long ticks, const TimerClock *clock));
+        TimerDuration getIdleTime() const;
+        unsigned long long getIdleTicks() const {return idleTicks;}
+        void resetIdleTime();
+        const TimerClock *getClock() const {return clock;}
+        // With stagger on, add() picks each fixed rate timer's first trigger (within one period)
+        // so it lands on the least loaded slots, spreading timers with common periods out
+        // instead of all firing in the same update(). Fixed delay timers slip a tick a period
+        // and would drift out of any slot, so they're added as usual; set the rate mode before
+        // add(). Timers added before turning it on are left alone. restart(), setDelay() and
+        // friends keep the timer's new phase and period, and move its load to match.
+        void setStagger(bool pStagger) {stagger = pStagger;}
+        bool getStagger() const {return stagger;}
+        // Planned triggers per window landing in each slot, from staggered timers only
+        unsigned int getSlotLoad(unsigned int slot) const {return slot < TIMER_STAGGER_SLOTS ? slotLoad[slot] : 0;}
+        unsigned int getMaxSlotLoad() const;
+        void printSlotLoad();
+#if FIRMWORK_TIMER_STATS
+        // TimerStats for every timer on the wheel, one line each
+        void printStats();
+#endif
+    private:
+        const TimerClock *clock;
+        Timer *wheel[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+        unsigned long long occupied[TIMER_WHEEL_LEVELS];
+        unsigned long long currentTick = 0;
+        unsigned int timerCount = 0;
+        bool started = false;
+        bool firing = false;
+        unsigned long long idleTicks = 0;
+        void (*idleFunction)(unsigned long long, const TimerClock *) = nullptr;
+        void insert(Timer *timer);
+        void unlink(Timer *timer);
+        // Expired timers, off the wheel but remembered so restart() can bring them back
+        Timer *expired = nullptr;
+        void park(Timer *timer);
+        void unpark(Timer *timer);
+        void cascade(byte level, byte slot);
+        void promoteEarliest(byte level, byte slot);
+        unsigned long long nextOccupiedTick() const;
+        unsigned int fireSlot(byte slot, unsigned long long now);
+        bool stagger = false;
+        unsigned long long staggerSlotTicks;
+        uint16_t slotLoad[TIMER_STAGGER_SLOTS];
+        void staggerTimer(Timer *timer);
+        void restagger(Timer *timer);
+        unsigned int staggerStride(unsigned long long delayTicks) const;
+        void chargeSlots(unsigned int first, unsigned int stride, int amount);
+};
+
+
+#endif //FIRMWORK_TIMERSCHEDULER_H
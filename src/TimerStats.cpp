@@ -0,0 +1,44 @@
+//
+// Created by Andrew Simmons on 10/15/26.
+//
+
+#include "TimerStats.h"
+
+void TimerStats::record(unsigned long long lateTicks, unsigned long long periodTicks, unsigned long execMicros)
+{
+    if(count == 0 || lateTicks < lateMin)
+        lateMin = lateTicks;
+    if(lateTicks > lateMax)
+        lateMax = lateTicks;
+    lateTotal += lateTicks;
+    if(count == 0 || execMicros < execMin)
+        execMin = execMicros;
+    if(execMicros > execMax)
+        execMax = execMicros;
+    execTotal += execMicros;
+    count++;
+
+    byte bin = lateTicks == 0 ? 0 : 64 - __builtin_clzll(lateTicks);
+    histogram[bin < TIMER_STATS_BINS ? bin : TIMER_STATS_BINS - 1]++;
+
+    if(periodTicks > 0 && lateTicks >= periodTicks)
+    {
+        deadlineMisses++;
+        missedPeriods += lateTicks / periodTicks;
+    }
+}
+
+void TimerStats::clear()
+{
+    *this = TimerStats();
+}
+
+void TimerStats::print(const char *label) const
+{
+    Serial.printf("%s count=%lu late_ticks min=%llu mean=%.1f max=%llu exec_us min=%lu mean=%.1f max=%lu misses=%lu missed_periods=%llu hist=",
+                  label, count, getLateMin(), getLateMean(), lateMax, getExecMin(), getExecMean(), execMax,
+                  deadlineMisses, missedPeriods);
+    for(byte bin = 0; bin < TIMER_STATS_BINS; bin++)
+        Serial.printf(bin == 0 ? "%lu" : "/%lu", histogram[bin]);
+    Serial.printf("\n");
+}
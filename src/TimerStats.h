@@ -0,0 +1,54 @@
+//
+// Created by Andrew Simmons on 10/15/26.
+//
+
+#ifndef FIRMWORK_TIMERSTATS_H
+#define FIRMWORK_TIMERSTATS_H
+#include <Arduino.h>
+
+// Off unless the build turns it on (FIRMWORK_TIMER_STATS=1 in platformio.ini's build_flags).
+// Off, Timer has no stats member and nothing extra runs around its callback. It changes Timer's
+// layout, so it has to be the same for every file: build flags only.
+#if !defined(FIRMWORK_TIMER_STATS)
+#define FIRMWORK_TIMER_STATS 0
+#endif
+
+// Lateness histogram, bin 0 is on time, bin n is 2^(n-1) up to 2^n ticks late, the last bin
+// takes everything beyond
+#define TIMER_STATS_BINS 12
+
+// How one Timer's triggers actually went: lateness against its deadline in the timer's clock
+// ticks, and callback run time in micros.
+class TimerStats
+{
+    public:
+        void record(unsigned long long lateTicks, unsigned long long periodTicks, unsigned long execMicros);
+        void clear();
+        unsigned long getCount() const {return count;}
+        unsigned long long getLateMin() const {return count > 0 ? lateMin : 0;}
+        unsigned long long getLateMax() const {return lateMax;}
+        float getLateMean() const {return count > 0 ? (float)lateTotal / count : 0;}
+        unsigned long getExecMin() const {return count > 0 ? execMin : 0;}
+        unsigned long getExecMax() const {return execMax;}
+        float getExecMean() const {return count > 0 ? (float)execTotal / count : 0;}
+        unsigned long getHistogram(byte bin) const {return bin < TIMER_STATS_BINS ? histogram[bin] : 0;}
+        // Triggers that came a whole period or more late, and how many periods that added up to
+        unsigned long getDeadlineMisses() const {return deadlineMisses;}
+        unsigned long long getMissedPeriods() const {return missedPeriods;}
+        // One line to Serial, label is whatever says which timer this is
+        void print(const char *label) const;
+    private:
+        unsigned long count = 0;
+        unsigned long long lateMin = 0;
+        unsigned long long lateMax = 0;
+        unsigned long long lateTotal = 0;
+        unsigned long execMin = 0;
+        unsigned long execMax = 0;
+        unsigned long long execTotal = 0;
+        unsigned long histogram[TIMER_STATS_BINS] = {};
+        unsigned long deadlineMisses = 0;
+        unsigned long long missedPeriods = 0;
+};
+
+
+#endif //FIRMWORK_TIMERSTATS_H
@@ -0,0 +1,103 @@
+//
+// Created by Andrew Simmons on 10/16/26.
+//
+
+#include <Arduino.h>
+#include <AccelStepper.h>
+#include <unity.h>
+#include <thread>
+#include "SpscQueue.h"
+#include "StepperManager.h"
+
+// One thread posting, another consuming, like a network task on core 0 and loop() on core 1.
+// Every item carries its sequence number, so anything lost, repeated, reordered or torn shows
+// up on the consumer side. Counted there and asserted once the producer is joined.
+
+#define STRESS_COUNT 200000
+
+typedef struct SequencedItem
+{
+    uint32_t sequence;
+    uint32_t check;  // ~sequence, a half written slot won't match
+} SequencedItem;
+
+void test_spsc_queue_two_threads()
+{
+    // Small, so the indices lap it thousands of times and it's full a lot
+    static SpscQueue<SequencedItem, 8> queue;
+    std::thread producer([]() {
+        for(uint32_t i = 1; i <= STRESS_COUNT; i++)
+        {
+            SequencedItem item = {i, ~i};
+            while(!queue.push(item))
+                std::this_thread::yield();
+        }
+    });
+
+    uint32_t expected = 1;
+    unsigned long errors = 0;
+    while(expected <= STRESS_COUNT)
+    {
+        SequencedItem item;
+        if(!queue.pop(item))
+        {
+            std::this_thread::yield();
+            continue;
+        }
+        if(item.sequence != expected || item.check != ~item.sequence)
+            errors++;
+        expected = item.sequence + 1;
+    }
+    producer.join();
+
+    TEST_ASSERT_EQUAL_UINT32(0, errors);
+    TEST_ASSERT_TRUE(queue.isEmpty());
+}
+
+// Every command is a position, so run() should only ever land on the count applied so far
+void test_stepper_commands_two_threads()
+{
+    AccelStepper stepper(AccelStepper::DRIVER, 8, 9);
+    StepperManager manager(&stepper);
+    std::thread producer([&manager]() {
+        for(long i = 1; i <= STRESS_COUNT; i++)
+        {
+            while(!manager.postCommand(STEPPER_COMMAND_SET_POSITION, i))
+                std::this_thread::yield();
+        }
+    });
+
+    long last = 0;
+    unsigned long errors = 0;
+    while(manager.getCommandsApplied() < STRESS_COUNT)
+    {
+        manager.run();
+        long position = manager.currentPosition();
+        if(position < last || position != (long)manager.getCommandsApplied())
+            errors++;
+        // Nothing new, let the producer have the CPU if they share one
+        if(position == last)
+            std::this_thread::yield();
+        last = position;
+    }
+    producer.join();
+
+    TEST_ASSERT_EQUAL_UINT32(0, errors);
+    TEST_ASSERT_EQUAL_INT32(STRESS_COUNT, manager.currentPosition());
+}
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_spsc_queue_two_threads);
+    RUN_TEST(test_stepper_commands_two_threads);
+    return UNITY_END();
+}
@@ -0,0 +1,112 @@
+//
+// Created by Andrew Simmons on 10/16/26.
+//
+
+#include <Arduino.h>
+#include <AccelStepper.h>
+#include <unity.h>
+#include "StepperManager.h"
+#include "StepperGroup.h"
+#include "StepProfile.h"
+
+// micros() is 32 bits on the device and wraps every 71.6 minutes. Everything timing steps off
+// it has to behave the same straddling the wrap as anywhere else.
+
+#define WRAP_32 (1ULL << 32)
+#define POLL_MICROS 5
+
+void test_run_speed_across_wrap()
+{
+    AccelStepper stepper(AccelStepper::DRIVER, 2, 3);
+    stepper.setMaxSpeed(1000);
+    stepper.setSpeed(100);
+    // About half a second either side, off the 10ms grid so no step lands right on the wrap
+    VirtualClock::set(WRAP_32 - 503000);
+    unsigned long long end = VirtualClock::now() + 995000;
+    unsigned long long lastStep = 0;
+    unsigned long steps = 0;
+    while(VirtualClock::now() < end)
+    {
+        if(stepper.runSpeed())
+        {
+            if(steps > 0)
+                TEST_ASSERT_EQUAL_UINT64(10000, VirtualClock::now() - lastStep);
+            lastStep = VirtualClock::now();
+            steps++;
+        }
+        VirtualClock::advance(1);
+    }
+    TEST_ASSERT_EQUAL_UINT32(100, steps);
+}
+
+// Micros a move takes to finish when started at start
+static unsigned long long timeProfiledMove(unsigned long long start)
+{
+    AccelStepper stepper(AccelStepper::DRIVER, 2, 3);
+    StepperManager manager(&stepper);
+    StepProfile profile;
+    profile.setMaxSpeed(10000);
+    profile.setAcceleration(20000);
+    manager.setProfile(&profile);
+    VirtualClock::set(start);
+    manager.moveProfiled(5000);
+    while(manager.getMode() == STEPPER_PROFILE)
+    {
+        manager.run();
+        VirtualClock::advance(POLL_MICROS);
+    }
+    TEST_ASSERT_EQUAL_INT32(5000, manager.currentPosition());
+    return VirtualClock::now() - start;
+}
+
+void test_profile_across_wrap()
+{
+    unsigned long long away = timeProfiledMove(1000000000ULL);
+    unsigned long long across = timeProfiledMove(WRAP_32 - away / 2);
+    TEST_ASSERT_EQUAL_UINT64(away, across);
+}
+
+static unsigned long long timeGroupMove(unsigned long long start)
+{
+    AccelStepper stepperX(AccelStepper::DRIVER, 2, 3);
+    AccelStepper stepperY(AccelStepper::DRIVER, 4, 5);
+    StepperManager x(&stepperX);
+    StepperManager y(&stepperY);
+    StepperGroup group;
+    group.addStepper(&x);
+    group.addStepper(&y);
+    group.setMaxSpeed(10000);
+    group.setAcceleration(20000);
+    VirtualClock::set(start);
+    long target[] = {5000, 2000};
+    group.moveToAbsolute(target);
+    while(group.run())
+        VirtualClock::advance(POLL_MICROS);
+    TEST_ASSERT_EQUAL_INT32(5000, x.currentPosition());
+    TEST_ASSERT_EQUAL_INT32(2000, y.currentPosition());
+    return VirtualClock::now() - start;
+}
+
+void test_group_across_wrap()
+{
+    unsigned long long away = timeGroupMove(1000000000ULL);
+    unsigned long long across = timeGroupMove(WRAP_32 - away / 2);
+    TEST_ASSERT_EQUAL_UINT64(away, across);
+}
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_run_speed_across_wrap);
+    RUN_TEST(test_profile_across_wrap);
+    RUN_TEST(test_group_across_wrap);
+    return UNITY_END();
+}
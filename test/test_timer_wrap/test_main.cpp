@@ -0,0 +1,89 @@
+//
+// Created by Andrew Simmons on 10/16/26.
+//
+
+#include <Arduino.h>
+#include <unity.h>
+#include "Timer.h"
+#include "TimerClock.h"
+
+// The 32 bit millis()/micros() wrap, fast forwarded on the virtual clock: a timer running
+// across it has to keep firing exactly once a period.
+
+#define WRAP_32 (1ULL << 32)
+
+static unsigned long fires;
+static unsigned long long fireTicks[16];
+
+static void onFire(unsigned long long, Timer *timer)
+{
+    if(fires < 16)
+        fireTicks[fires] = timer->getClock()->now();
+    fires++;
+}
+
+// Polls every pollMicros for periods + a bit, checking each fire landed exactly one period apart
+static void runAcrossWrap(Timer *timer, unsigned long long periodTicks, unsigned long periods, unsigned long long pollMicros)
+{
+    fires = 0;
+    timer->setTriggerFunction(onFire);
+    timer->restart();
+    unsigned long long until = VirtualClock::now() + (periods * periodTicks + periodTicks / 2) * (1000000ULL / timer->getClock()->ticksPerSecond);
+    while(VirtualClock::now() < until)
+    {
+        VirtualClock::advance(pollMicros);
+        timer->update();
+    }
+    TEST_ASSERT_EQUAL_UINT32(periods, fires);
+    for(unsigned long i = 1; i < fires && i < 16; i++)
+        TEST_ASSERT_EQUAL_UINT64(periodTicks, fireTicks[i] - fireTicks[i - 1]);
+}
+
+void test_micros_wrap_fixed_rate()
+{
+    // 5 periods of 1ms either side of micros() wrapping
+    VirtualClock::set(WRAP_32 - 5000);
+    TEST_ASSERT_EQUAL_UINT32(0xFFFFFFFFUL - 4999, (uint32_t)micros());
+    unsigned long long before = micros64();
+    Timer timer(TimerDuration::fromMillis(1), &MicrosClock);
+    timer.setRateMode(TIMER_FIXED_RATE);
+    runAcrossWrap(&timer, 1000, 10, 10);
+    TEST_ASSERT_TRUE(micros64() > WRAP_32);
+    TEST_ASSERT_TRUE(micros64() > before);
+}
+
+void test_micros_wrap_fixed_delay()
+{
+    // Fixed delay fires delay + 1 ticks apart, on both sides of the wrap
+    VirtualClock::set(3 * WRAP_32 - 5000);
+    Timer timer(TimerDuration::fromMicros(999), &MicrosClock);
+    runAcrossWrap(&timer, 1000, 10, 1);
+}
+
+void test_millis_wrap_fixed_rate()
+{
+    // 5 periods of 1s either side of millis() wrapping, 49.7 days in
+    VirtualClock::set((WRAP_32 - 5000) * 1000ULL);
+    TEST_ASSERT_EQUAL_UINT32(0xFFFFFFFFUL - 4999, (uint32_t)millis());
+    Timer timer(TimerDuration::fromSeconds(1), &MillisClock);
+    timer.setRateMode(TIMER_FIXED_RATE);
+    runAcrossWrap(&timer, 1000, 10, 1000);
+    TEST_ASSERT_TRUE(millis64() > WRAP_32);
+}
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_micros_wrap_fixed_rate);
+    RUN_TEST(test_micros_wrap_fixed_delay);
+    RUN_TEST(test_millis_wrap_fixed_rate);
+    return UNITY_END();
+}